@@ -0,0 +1,232 @@
+#include "devices/hrtimer.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* See [8254] for the PIT and [IA32-v3a] 17.17 for the TSC. */
+
+/* 8254 input frequency. */
+#define PIT_HZ 1193180
+
+/* Length of the TSC calibration.  PIT counter 2 times it, so it
+   must fit in 16 bits of PIT cycles, about 54 ms. */
+#define CALIBRATE_MS 50
+#define CALIBRATE_COUNT (PIT_HZ * CALIBRATE_MS / 1000)
+
+/* Nanoseconds per timer tick. */
+#define NS_PER_TICK (NSEC_PER_SEC / TIMER_FREQ)
+
+/* TSC frequency in Hz, or 0 until hrtimer_calibrate(). */
+static uint64_t tsc_hz;
+
+/* hrtimer_now() is BASE_NS plus the TSC cycles since TSC_BASE,
+   times TSC_MULT / 2**32 ns per cycle. */
+static uint64_t tsc_base;
+static uint64_t tsc_mult;
+static uint64_t base_ns;
+
+/* Armed timers, earliest expiry first. */
+static struct rb_tree pending;
+
+static bool hrtimer_less (const struct rb_elem *, const struct rb_elem *,
+                          void *aux);
+static void hrtimer_program (void);
+static hrtimer_func hrtimer_wakeup;
+
+/* Measures the TSC frequency against PIT counter 2 and starts the
+   nanosecond clock.  Must be called with interrupts on, after
+   timer_calibrate().
+
+   Counter 2 is the one gated by the speaker port and polled
+   through it, so it can time the calibration without an
+   interrupt and without disturbing counter 0's tick. */
+void
+hrtimer_calibrate (void) {
+	uint64_t start, end, hz;
+	uint8_t gate;
+
+	ASSERT (intr_get_level () == INTR_ON);
+	printf ("Calibrating TSC...  ");
+
+	gate = inb (0x61);
+	outb (0x61, (gate & ~0x02) | 0x01); /* Gate counter 2 on, speaker off. */
+	outb (0x43, 0xb0);  /* CW: counter 2, LSB then MSB, mode 0, binary. */
+	outb (0x42, CALIBRATE_COUNT & 0xff);
+	outb (0x42, CALIBRATE_COUNT >> 8);
+	start = rdtsc ();
+	while ((inb (0x61) & 0x20) == 0)    /* Wait for OUT2 to go high. */
+		continue;
+	end = rdtsc ();
+	outb (0x61, gate);
+
+	hz = (end - start) * 1000 / CALIBRATE_MS;
+	rb_init (&pending);
+	base_ns = timer_ticks () * NS_PER_TICK;
+	tsc_base = rdtsc ();
+	tsc_mult = ((uint64_t) NSEC_PER_SEC << 32) / hz;
+	barrier ();
+	tsc_hz = hz;
+
+	printf ("%'" PRIu64 " Hz.\n", tsc_hz);
+}
+
+/* Returns the nanoseconds since the OS booted.  Before
+   hrtimer_calibrate(), this has only timer tick resolution. */
+uint64_t
+hrtimer_now (void) {
+	uint64_t cycles;
+
+	if (tsc_hz == 0)
+		return timer_ticks () * NS_PER_TICK;
+
+	cycles = rdtsc () - tsc_base;
+	return base_ns + (uint64_t) (((unsigned __int128) cycles * tsc_mult) >> 32);
+}
+
+/* Returns the TSC frequency in Hz, or 0 if it has not been
+   calibrated yet. */
+uint64_t
+hrtimer_tsc_hz (void) {
+	return tsc_hz;
+}
+
+/* Initializes T to call FUNC(AUX) when it fires. */
+void
+hrtimer_init (struct hrtimer *t, hrtimer_func *func, void *aux) {
+	ASSERT (t != NULL);
+	ASSERT (func != NULL);
+
+	t->func = func;
+	t->aux = aux;
+	t->expires = 0;
+	t->pending = false;
+}
+
+/* Arms T to fire once hrtimer_now() reaches EXPIRES, re-arming it
+   if it is already pending.  An expiry in the past fires on the
+   next timer interrupt, never within this call.  May be called
+   from an interrupt handler, including from an hrtimer
+   callback. */
+void
+hrtimer_start (struct hrtimer *t, uint64_t expires) {
+	enum intr_level old_level;
+
+	ASSERT (t != NULL);
+	ASSERT (tsc_hz != 0);
+
+	old_level = intr_disable ();
+	if (t->pending)
+		rb_remove (&pending, &t->elem);
+	t->expires = expires;
+	t->pending = true;
+	rb_insert (&pending, &t->elem, hrtimer_less, NULL);
+	if (rb_min (&pending) == &t->elem)
+		hrtimer_program ();
+	intr_set_level (old_level);
+}
+
+/* Disarms T.  Returns true if T was pending, false if it had
+   already fired or was never armed. */
+bool
+hrtimer_cancel (struct hrtimer *t) {
+	enum intr_level old_level = intr_disable ();
+	bool was_pending = t->pending;
+
+	if (was_pending) {
+		rb_remove (&pending, &t->elem);
+		t->pending = false;
+	}
+	intr_set_level (old_level);
+	return was_pending;
+}
+
+/* Blocks the running thread for NS nanoseconds.  Must be called
+   with interrupts on. */
+void
+hrtimer_nsleep (int64_t ns) {
+	struct hrtimer t;
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+	ASSERT (intr_get_level () == INTR_ON);
+
+	if (ns <= 0)
+		return;
+
+	hrtimer_init (&t, hrtimer_wakeup, thread_current ());
+	old_level = intr_disable ();
+	hrtimer_start (&t, hrtimer_now () + ns);
+	thread_block ();
+	intr_set_level (old_level);
+}
+
+/* Fires every timer that is due and arranges an interrupt for the
+   next one.  Called by the timer interrupt handler. */
+void
+hrtimer_run (void) {
+	uint64_t now;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (tsc_hz == 0)
+		return;
+
+	now = hrtimer_now ();
+	while (!rb_empty (&pending)) {
+		struct hrtimer *t = rb_entry (rb_min (&pending), struct hrtimer, elem);
+		if (t->expires > now)
+			break;
+		rb_remove (&pending, &t->elem);
+		t->pending = false;
+		t->func (t->aux);
+	}
+	if (!rb_empty (&pending))
+		hrtimer_program ();
+}
+
+/* Returns the number of whole timer ticks before the next timer is
+   due, or INT64_MAX if none is armed.  Interrupts must be off. */
+int64_t
+hrtimer_next_ticks (void) {
+	struct hrtimer *t;
+	uint64_t now;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (rb_empty (&pending))
+		return INT64_MAX;
+
+	t = rb_entry (rb_min (&pending), struct hrtimer, elem);
+	now = hrtimer_now ();
+	return t->expires > now ? (int64_t) ((t->expires - now) / NS_PER_TICK) : 0;
+}
+
+/* Orders timers by expiry. */
+static bool
+hrtimer_less (const struct rb_elem *a_, const struct rb_elem *b_,
+              void *aux UNUSED) {
+	const struct hrtimer *a = rb_entry (a_, struct hrtimer, elem);
+	const struct hrtimer *b = rb_entry (b_, struct hrtimer, elem);
+
+	return a->expires < b->expires;
+}
+
+/* Asks the timer for an interrupt when the earliest pending timer
+   is due, if that comes before the next tick.  Later timers are
+   left to hrtimer_run() at a later tick. */
+static void
+hrtimer_program (void) {
+	struct hrtimer *t = rb_entry (rb_min (&pending), struct hrtimer, elem);
+
+	timer_hr_arm ((int64_t) (t->expires - hrtimer_now ()));
+}
+
+/* Callback that readies the thread T sleeping in
+   hrtimer_nsleep(). */
+static void
+hrtimer_wakeup (void *t) {
+	thread_unblock (t);
+}
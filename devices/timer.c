@@ -3,6 +3,7 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/hrtimer.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
@@ -20,7 +21,62 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-int64_t MIN_alarm_time = INT64_MAX;
+/* Timer wheel.
+
+   Pending timeouts are hashed into WHEEL_LEVELS levels of
+   WHEEL_SIZE slots each.  Level 0 holds timeouts due within the
+   next WHEEL_SIZE ticks, one slot per tick; each higher level
+   covers WHEEL_SIZE times the range of the one below it.  Every
+   WHEEL_SIZE ticks, the next slot of level 1 is "cascaded" down
+   by re-inserting its entries, and so on up the hierarchy, so
+   each timeout is moved at most WHEEL_LEVELS times before it
+   fires.  Timeouts further out than the top level can reach are
+   parked in the top level and re-hashed when it cascades. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+/* Next tick whose level-0 slot has not been run yet. */
+static int64_t wheel_clock;
+
+/* -tickless: stop the periodic tick while the CPU is idle?
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* 8254 input frequency and the counter value for one tick. */
+#define PIT_HZ 1193180
+#define PIT_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest one-shot the 16-bit counter can time, in ticks.  A
+   longer stop is timed by a chain of one-shots. */
+#define PIT_MAX_TICKS (0xffff / PIT_COUNT)
+
+/* While the periodic tick is stopped, the PIT runs a one-shot
+   countdown of STOPPED_COUNT that ends on a tick boundary; its
+   interrupt accounts for STOPPED_TICKS ticks.  If STOP_LEFT more
+   ticks of the stop remain after that, the interrupt starts the
+   next one-shot of the chain itself.  STOPPED_TICKS is 0 while
+   the PIT is in periodic mode. */
+static int64_t stopped_ticks;
+static uint16_t stopped_count;
+static int64_t stop_left;
+
+/* While the PIT runs a one-shot of SPLIT_FIRST cycles that
+   timer_hr_arm() programmed for an hrtimer due before the next
+   tick, the number of cycles from its end to that tick.  The
+   interrupt that ends it runs the hrtimers and then finishes the
+   tick as a stopped-tick one-shot of SPLIT_COUNT cycles.
+   SPLIT_COUNT is 0 otherwise. */
+static uint16_t split_count;
+static uint16_t split_first;
+
+/* Shortest delay worth blocking on an hrtimer for.  That costs a
+   PIT reprogram and two context switches, far more than the
+   waits of a few microseconds that device drivers make, so
+   shorter delays busy-wait instead. */
+#define HR_SLEEP_MIN_NS (50 * 1000)
 
 #define F (1 << 14) /* fixed point 1 */
 
@@ -32,19 +88,27 @@ static intr_handler_func timer_interrupt;
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
+static void wheel_insert(struct timeout *);
+static void wheel_run(int64_t now);
+static int64_t wheel_next_expiry(int64_t limit);
+static void pit_periodic(void);
+static void pit_oneshot(uint16_t count);
+static uint16_t pit_read_back(uint8_t *status);
+static void timer_advance(bool running);
+static void stop_next_leg(void);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
 void timer_init(void)
 {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	int level, slot;
 
-	outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb(0x40, count & 0xff);
-	outb(0x40, count >> 8);
+	for (level = 0; level < WHEEL_LEVELS; level++)
+		for (slot = 0; slot < WHEEL_SIZE; slot++)
+			list_init(&wheel[level][slot]);
+
+	pit_periodic();
 
 	intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
@@ -123,26 +187,432 @@ void timer_print_stats(void)
 	printf("Timer: %" PRId64 " ticks\n", timer_ticks());
 }
 
+/* Initializes timeout T to call FUNC(AUX) when it fires. */
+void timeout_init(struct timeout *t, timeout_func *func, void *aux)
+{
+	ASSERT(t != NULL);
+	ASSERT(func != NULL);
+
+	t->func = func;
+	t->aux = aux;
+	t->expires = 0;
+	t->pending = false;
+}
+
+/* Arms T to fire at timer tick EXPIRES, re-arming it if it is
+   already pending.  A tick in the past fires on the next timer
+   interrupt.  May be called from an interrupt handler, including
+   from a timeout callback. */
+void timeout_add(struct timeout *t, int64_t expires)
+{
+	enum intr_level old_level = intr_disable();
+
+	if (t->pending)
+		list_remove(&t->elem);
+	t->expires = expires;
+	t->pending = true;
+	wheel_insert(t);
+
+	intr_set_level(old_level);
+}
+
+/* Disarms T.  Returns true if T was pending, false if it had
+   already fired or was never armed. */
+bool timeout_cancel(struct timeout *t)
+{
+	enum intr_level old_level = intr_disable();
+	bool was_pending = t->pending;
+
+	if (was_pending)
+	{
+		list_remove(&t->elem);
+		t->pending = false;
+	}
+
+	intr_set_level(old_level);
+	return was_pending;
+}
+
+/* Returns true if T is armed and has not fired yet. */
+bool timeout_pending(const struct timeout *t)
+{
+	return t->pending;
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  In tickless mode, replaces the periodic tick by
+   one-shot interrupts up to the next timeout expiry, so an idle
+   CPU is not woken up every tick for nothing.  The PIT can only
+   time PIT_MAX_TICKS ticks at once, so a longer stop is a chain
+   of one-shots, each started by the interrupt that ends the one
+   before. */
+void timer_idle_enter(void)
+{
+	int64_t n;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	if (!timer_tickless || stopped_ticks != 0 || split_count != 0)
+		return;
+
+	n = wheel_next_expiry(hrtimer_next_ticks());
+	if (n <= 1)
+		return;
+
+	stop_left = n;
+	stop_next_leg();
+}
+
+/* Called by the idle thread, with interrupts off, when an
+   interrupt has woken it and no thread is ready to run.  Returns
+   true if the tick is still stopped and no timeout or hrtimer is
+   now due before the stop ends, in which case the idle thread
+   may halt again without going through the scheduler. */
+bool timer_idle_resume(void)
+{
+	int64_t left = stopped_ticks + stop_left;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	return (stopped_ticks != 0 && split_count == 0
+			&& hrtimer_next_ticks() >= left && wheel_next_expiry(left) >= left);
+}
+
+/* Called by the idle thread, with interrupts off, when it wakes
+   up and is about to let another thread run.  If the tick is
+   still stopped, shortens the one-shot to end at the next tick
+   boundary; its interrupt then accounts for the whole ticks slept
+   and restarts periodic mode, so the tick phase is not lost. */
+void timer_idle_exit(void)
+{
+	uint8_t status;
+	uint16_t left, next;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	if (stopped_ticks == 0)
+		return;
+
+	/* End the stop with this one-shot. */
+	stop_left = 0;
+
+	left = pit_read_back(&status);
+
+	/* OUT is high once the countdown expired: its interrupt is
+	   pending and will do the accounting.  A null count means the
+	   count we wrote has not even been loaded yet. */
+	if (status & 0x80)
+		return;
+	if (status & 0x40 || left > stopped_count)
+		left = stopped_count;
+
+	next = left % PIT_COUNT != 0 ? left % PIT_COUNT : PIT_COUNT;
+	stopped_ticks -= (left - next) / PIT_COUNT;
+	stopped_count = next;
+	pit_oneshot(next);
+}
+
+/* Arranges for a timer interrupt NS nanoseconds from now, for
+   hrtimer_run(), if that comes before the next tick.  Interrupts
+   must be off.
+
+   Counter 0 is switched to a one-shot that ends at the deadline;
+   the rest of the tick is then timed by a second one-shot, so the
+   tick phase is kept.  Nothing is done while the idle CPU has the
+   tick stopped for several ticks, since timer_idle_enter() already
+   ended that stop on the tick before the deadline, and
+   timer_idle_resume() ends it early for a timer added since. */
+void timer_hr_arm(int64_t ns)
+{
+	uint8_t status;
+	uint16_t left, to_tick, first;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	if (stopped_ticks > 1 || stop_left != 0)
+		return;
+
+	left = pit_read_back(&status);
+	if (stopped_ticks == 0 && split_count == 0)
+	{
+		/* Periodic mode.  If the tick's interrupt is already
+		   raised, it will call hrtimer_run() itself. */
+		outb(0x20, 0x0a); /* OCW3: read the master PIC's IRR. */
+		if (inb(0x20) & 0x01)
+			return;
+		to_tick = left;
+	}
+	else
+	{
+		/* A one-shot is counting down: the last one of a stopped
+		   tick, or one for an earlier hrtimer. */
+		uint16_t count = stopped_ticks != 0 ? stopped_count : split_first;
+		if (status & 0x80)
+			return;
+		if (status & 0x40 || left > count)
+			left = count;
+		to_tick = left + split_count;
+	}
+
+	if (ns <= 0)
+		first = 1;
+	else if (ns >= (int64_t)to_tick * NSEC_PER_SEC / PIT_HZ)
+		return;
+	else
+		first = ns * PIT_HZ / NSEC_PER_SEC + 1;
+	if (first >= to_tick)
+		return;
+
+	stopped_ticks = 0;
+	split_first = first;
+	split_count = to_tick - first;
+	pit_oneshot(first);
+}
+
 static void timer_interrupt(struct intr_frame *args UNUSED)
+{
+	int64_t slept = 0;
+
+	if (split_count != 0)
+	{
+		/* An hrtimer deadline within the tick.  Finish the tick
+		   with a one-shot to its boundary. */
+		stopped_ticks = 1;
+		stopped_count = split_count;
+		split_count = 0;
+		pit_oneshot(stopped_count);
+		hrtimer_run();
+		return;
+	}
+
+	if (stopped_ticks != 0 && stop_left != 0)
+	{
+		/* End of one one-shot of a chain.  The CPU is still idle,
+		   or timer_idle_exit() would have ended the chain, so
+		   charge every tick to the idle thread and start the next
+		   one-shot. */
+		for (slept = stopped_ticks; slept > 0; slept--)
+			timer_advance(false);
+		stop_next_leg();
+		hrtimer_run();
+		return;
+	}
+
+	if (stopped_ticks != 0)
+	{
+		/* End of a stopped-tick period.  Every tick but the last
+		   one was spent in the idle thread. */
+		slept = stopped_ticks - 1;
+		stopped_ticks = 0;
+		pit_periodic();
+	}
+
+	while (slept-- > 0)
+		timer_advance(false);
+	timer_advance(true);
+	hrtimer_run();
+}
+
+/* Advances the clock by one tick and does that tick's periodic
+   work.  RUNNING is false for ticks that are being caught up
+   after the idle CPU had the periodic tick stopped. */
+static void
+timer_advance(bool running)
 {
 	ticks++;
-	thread_tick();
+	if (running)
+		thread_tick();
+	else
+		thread_tick_idle();
 
 	if (thread_mlfqs) 
 	{
-        mlfqs_increment();
-        if (timer_ticks() % 4 == 0)
+		if (running)
+			mlfqs_increment();
+        if (ticks % 4 == 0)
             mlfqs_recalc_priority();
 
-        if (timer_ticks() % 100 == 0) 
+        if (ticks % 100 == 0) 
 		{
             mlfqs_load_avg();
             mlfqs_recalc_recent_cpu();
         }
     }
-	
-	if (MIN_alarm_time <= ticks)
-		thread_awake(ticks);
+
+	wheel_run(ticks);
+}
+
+/* Starts the next one-shot of a stopped tick, for up to
+   PIT_MAX_TICKS of the STOP_LEFT ticks that remain. */
+static void
+stop_next_leg(void)
+{
+	stopped_ticks = stop_left < (int64_t)PIT_MAX_TICKS ? stop_left : (int64_t)PIT_MAX_TICKS;
+	stop_left -= stopped_ticks;
+	stopped_count = stopped_ticks * PIT_COUNT;
+	pit_oneshot(stopped_count);
+}
+
+/* Programs the PIT to interrupt TIMER_FREQ times per second. */
+static void
+pit_periodic(void)
+{
+	/* 8254 input frequency divided by TIMER_FREQ, rounded to
+	   nearest. */
+	uint16_t count = PIT_COUNT;
+
+	outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb(0x40, count & 0xff);
+	outb(0x40, count >> 8);
+}
+
+/* Programs the PIT to interrupt once, COUNT input cycles from
+   now. */
+static void
+pit_oneshot(uint16_t count)
+{
+	outb(0x43, 0x30); /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb(0x40, count & 0xff);
+	outb(0x40, count >> 8);
+}
+
+/* Reads back counter 0.  Stores its status byte into *STATUS and
+   returns its current count. */
+static uint16_t
+pit_read_back(uint8_t *status)
+{
+	uint16_t count;
+
+	outb(0x43, 0xc2); /* Read-back: status and count of counter 0. */
+	*status = inb(0x40);
+	count = inb(0x40);
+	count |= inb(0x40) << 8;
+	return count;
+}
+
+/* Hashes pending timeout T into the wheel slot that covers its
+   expiry, relative to wheel_clock. */
+static void
+wheel_insert(struct timeout *t)
+{
+	int64_t delta = t->expires - wheel_clock;
+	int64_t expires = t->expires;
+	int level;
+
+	if (delta < 0)
+	{
+		/* Already due: run it with the current slot. */
+		list_push_back(&wheel[0][wheel_clock & WHEEL_MASK], &t->elem);
+		return;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < (int64_t)1 << (WHEEL_BITS * (level + 1)))
+			break;
+
+	if (level == WHEEL_LEVELS - 1
+		&& delta >= (int64_t)1 << (WHEEL_BITS * WHEEL_LEVELS))
+	{
+		/* Beyond the wheel's reach: park it in the furthest top
+		   level slot.  It is re-hashed when that slot cascades. */
+		expires = wheel_clock + ((int64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+	}
+
+	list_push_back(&wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK],
+				   &t->elem);
+}
+
+/* Returns the number of ticks from now until the next timeout
+   is due, at most LIMIT and at least 1.  Looks through every
+   level, not just level 0: ticks skipped while the tick is stopped
+   are caught up one by one, cascades included, so only the
+   timeouts' own expiries matter.  Interrupts must be off. */
+static int64_t
+wheel_next_expiry(int64_t limit)
+{
+	int64_t n = limit;
+	int64_t tick;
+	int level, k;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	/* Level 0 holds the timeouts due in the WHEEL_SIZE ticks from
+	   wheel_clock, one slot per tick. */
+	for (tick = wheel_clock; tick < wheel_clock + WHEEL_SIZE && tick - ticks < n; tick++)
+		if (!list_empty(&wheel[0][tick & WHEEL_MASK]))
+		{
+			n = tick - ticks;
+			break;
+		}
+
+	/* A higher level's slot for block BLOCK + K holds timeouts due
+	   no earlier than the start of that block, or later still if
+	   parked beyond the wheel's reach.  wheel_clock's own block has
+	   already been cascaded, unless wheel_clock is its first tick. */
+	for (level = 1; level < WHEEL_LEVELS; level++)
+	{
+		int shift = WHEEL_BITS * level;
+		int64_t block = wheel_clock >> shift;
+		int first = (wheel_clock & (((int64_t)1 << shift) - 1)) == 0 ? 0 : 1;
+
+		for (k = first; k < first + WHEEL_SIZE && ((block + k) << shift) - ticks < n; k++)
+		{
+			struct list *l = &wheel[level][(block + k) & WHEEL_MASK];
+			struct list_elem *e;
+
+			for (e = list_begin(l); e != list_end(l); e = list_next(e))
+			{
+				struct timeout *t = list_entry(e, struct timeout, elem);
+				if (t->expires - ticks < n)
+					n = t->expires - ticks;
+			}
+		}
+	}
+	return n > 1 ? n : 1;
+}
+
+/* Re-hashes every timeout in slot SLOT of level LEVEL into the
+   levels below it. */
+static void
+wheel_cascade(int level, int slot)
+{
+	struct list *l = &wheel[level][slot];
+	struct list pending;
+
+	list_init(&pending);
+	while (!list_empty(l))
+		list_push_back(&pending, list_pop_front(l));
+	while (!list_empty(&pending))
+		wheel_insert(list_entry(list_pop_front(&pending), struct timeout, elem));
+}
+
+/* Fires every timeout due at or before tick NOW.
+   Runs in the timer interrupt handler. */
+static void
+wheel_run(int64_t now)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	while (wheel_clock <= now)
+	{
+		int slot = wheel_clock & WHEEL_MASK;
+		struct list *l = &wheel[0][slot];
+		int level;
+
+		/* Level 0 wrapped: pull the next window down from above. */
+		if (slot == 0)
+			for (level = 1; level < WHEEL_LEVELS; level++)
+			{
+				int upper = (wheel_clock >> (WHEEL_BITS * level)) & WHEEL_MASK;
+				wheel_cascade(level, upper);
+				if (upper != 0)
+					break;
+			}
+
+		while (!list_empty(l))
+		{
+			struct timeout *t = list_entry(list_pop_front(l), struct timeout, elem);
+			t->pending = false;
+			t->func(t->aux);
+		}
+		wheel_clock++;
+	}
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -190,8 +660,16 @@ real_time_sleep(int64_t num, int32_t denom)
 	   */
 	int64_t ticks = num * TIMER_FREQ / denom;
 
+	/* DENOM divides NSEC_PER_SEC for every caller. */
+	int64_t ns = num * (NSEC_PER_SEC / denom);
+
 	ASSERT(intr_get_level() == INTR_ON);
-	if (ticks > 0)
+	if (ns >= HR_SLEEP_MIN_NS && hrtimer_tsc_hz() != 0)
+	{
+		/* Block until an hrtimer wakes us. */
+		hrtimer_nsleep(ns);
+	}
+	else if (ticks > 0)
 	{
 		/* We're waiting for at least one full timer tick.  Use
 		   timer_sleep() because it will yield the CPU to other
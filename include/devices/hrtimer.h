@@ -0,0 +1,40 @@
+#ifndef DEVICES_HRTIMER_H
+#define DEVICES_HRTIMER_H
+
+#include <rbtree.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* High-resolution timers.
+
+   The time-stamp counter, calibrated once against the 8254 PIT at
+   boot, gives a monotonic clock in nanoseconds.  An hrtimer calls
+   FUNC(AUX) from an interrupt handler once that clock reaches its
+   expiry.  Expiries that fall between two timer ticks are met by
+   a PIT one-shot programmed just for them, so sleeping for less
+   than a tick neither waits for the next tick nor spins. */
+typedef void hrtimer_func (void *aux);
+
+struct hrtimer {
+	struct rb_elem elem;        /* Element in the pending tree. */
+	uint64_t expires;           /* hrtimer_now() at which to fire. */
+	hrtimer_func *func;         /* Callback. */
+	void *aux;                  /* Callback argument. */
+	bool pending;               /* Armed and not yet fired? */
+};
+
+#define NSEC_PER_SEC 1000000000
+
+void hrtimer_calibrate (void);
+uint64_t hrtimer_now (void);
+uint64_t hrtimer_tsc_hz (void);
+
+void hrtimer_init (struct hrtimer *, hrtimer_func *, void *aux);
+void hrtimer_start (struct hrtimer *, uint64_t expires);
+bool hrtimer_cancel (struct hrtimer *);
+void hrtimer_nsleep (int64_t ns);
+
+void hrtimer_run (void);
+int64_t hrtimer_next_ticks (void);
+
+#endif /* devices/hrtimer.h */
@@ -1,12 +1,17 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* -tickless: stop the periodic tick while idle. */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
@@ -20,4 +25,31 @@ void timer_nsleep (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+void timer_idle_enter (void);
+bool timer_idle_resume (void);
+void timer_idle_exit (void);
+void timer_hr_arm (int64_t ns);
+
+/* Kernel timeouts.
+
+   A timeout calls FUNC(AUX) from the timer interrupt once
+   timer_ticks() reaches its expiry tick.  The callback runs in
+   external interrupt context, so it must not sleep.  Pending
+   timeouts live on a hierarchical timer wheel, so arming,
+   cancelling and expiring one are all O(1) amortized. */
+typedef void timeout_func (void *aux);
+
+struct timeout {
+	struct list_elem elem;      /* Wheel slot list element. */
+	int64_t expires;            /* Tick at which to fire. */
+	timeout_func *func;         /* Callback. */
+	void *aux;                  /* Callback argument. */
+	bool pending;               /* Armed and not yet fired? */
+};
+
+void timeout_init (struct timeout *, timeout_func *, void *aux);
+void timeout_add (struct timeout *, int64_t expires);
+bool timeout_cancel (struct timeout *);
+bool timeout_pending (const struct timeout *);
+
 #endif /* devices/timer.h */
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+ *
+ * Like the doubly linked list in list.h, this tree does not
+ * allocate memory.  Each structure that can be in a tree embeds
+ * a struct rb_elem, and rb_entry() converts a struct rb_elem back
+ * to the structure that contains it.
+ *
+ * The tree is ordered by an rb_less_func supplied on insertion.
+ * Elements that compare equal are kept in insertion order, so
+ * the tree can be used as a priority queue that is FIFO among
+ * equal keys.  The minimum element is cached, so rb_min() takes
+ * constant time; insertion and removal take O(lg n) time. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rb_elem {
+	struct rb_elem *parent;     /* Parent, or null at the root. */
+	struct rb_elem *left;       /* Left (smaller) child. */
+	struct rb_elem *right;      /* Right (greater or equal) child. */
+	bool red;                   /* Red or black node? */
+};
+
+/* Tree. */
+struct rb_tree {
+	struct rb_elem *root;       /* Root, or null if empty. */
+	struct rb_elem *min;        /* Leftmost element, or null. */
+};
+
+/* Converts pointer to tree element RB_ELEM into a pointer to the
+   structure that RB_ELEM is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)               \
+	((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent     \
+		- offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+void rb_init (struct rb_tree *);
+
+void rb_insert (struct rb_tree *, struct rb_elem *,
+                rb_less_func *, void *aux);
+void rb_remove (struct rb_tree *, struct rb_elem *);
+
+struct rb_elem *rb_min (const struct rb_tree *);
+struct rb_elem *rb_next (struct rb_elem *);
+bool rb_empty (const struct rb_tree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,100 @@
+#ifndef __LIB_KERNEL_RHASH_H
+#define __LIB_KERNEL_RHASH_H
+
+/* Open-addressing hash table.
+ *
+ * An alternative to the chained hash table in hash.h with the
+ * same interface, so that either can be used for a table of
+ * supplemental pages, inodes or directory entries.  The table is
+ * an array of pointers to elements, searched with linear probing
+ * and kept in "Robin Hood" order, so a lookup touches a few
+ * adjacent slots rather than a linked list.  When it fills up,
+ * its elements are moved to a table twice its size a few at a
+ * time, as a side effect of later operations, instead of all at
+ * once.  See rhash.c for details.
+ *
+ * Like hash.h, the table does not allocate its elements.  Each
+ * structure that can be in a table embeds a struct rhash_elem,
+ * and rhash_entry() converts a struct rhash_elem back to the
+ * structure that contains it. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Hash element. */
+struct rhash_elem {
+	uint64_t hash;              /* Hash value, while in a table. */
+};
+
+/* Converts pointer to hash element RHASH_ELEM into a pointer to
+ * the structure that RHASH_ELEM is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the hash element. */
+#define rhash_entry(RHASH_ELEM, STRUCT, MEMBER)                 \
+	((STRUCT *) ((uint8_t *) &(RHASH_ELEM)->hash            \
+		- offsetof (STRUCT, MEMBER.hash)))
+
+/* Computes and returns the hash value for hash element E, given
+ * auxiliary data AUX. */
+typedef uint64_t rhash_hash_func (const struct rhash_elem *e, void *aux);
+
+/* Compares the value of two hash elements A and B, given
+ * auxiliary data AUX.  Returns true if A is less than B, or
+ * false if A is greater than or equal to B. */
+typedef bool rhash_less_func (const struct rhash_elem *a,
+		const struct rhash_elem *b,
+		void *aux);
+
+/* Performs some operation on hash element E, given auxiliary
+ * data AUX. */
+typedef void rhash_action_func (struct rhash_elem *e, void *aux);
+
+/* Hash table. */
+struct rhash {
+	size_t elem_cnt;            /* Number of elements in table. */
+	size_t slot_cnt;            /* Number of slots, a power of 2. */
+	struct rhash_elem **slots;  /* Array of `slot_cnt' slots. */
+	size_t old_slot_cnt;        /* Slots in table being emptied. */
+	struct rhash_elem **old_slots; /* Table being emptied, or null. */
+	size_t moved;               /* Old slots emptied so far. */
+	rhash_hash_func *hash;      /* Hash function. */
+	rhash_less_func *less;      /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `hash' and `less'. */
+};
+
+/* A hash table iterator. */
+struct rhash_iterator {
+	struct rhash *hash;         /* The hash table. */
+	size_t slot;                /* Current slot, old table first. */
+	struct rhash_elem *elem;    /* Current hash element. */
+};
+
+/* Basic life cycle. */
+bool rhash_init (struct rhash *, rhash_hash_func *, rhash_less_func *,
+                 void *aux);
+void rhash_clear (struct rhash *, rhash_action_func *);
+void rhash_destroy (struct rhash *, rhash_action_func *);
+
+/* Search, insertion, deletion. */
+struct rhash_elem *rhash_insert (struct rhash *, struct rhash_elem *);
+struct rhash_elem *rhash_replace (struct rhash *, struct rhash_elem *);
+struct rhash_elem *rhash_find (struct rhash *, struct rhash_elem *);
+struct rhash_elem *rhash_delete (struct rhash *, struct rhash_elem *);
+
+/* Iteration. */
+void rhash_apply (struct rhash *, rhash_action_func *);
+void rhash_first (struct rhash_iterator *, struct rhash *);
+struct rhash_elem *rhash_next (struct rhash_iterator *);
+struct rhash_elem *rhash_cur (struct rhash_iterator *);
+
+/* Information. */
+size_t rhash_size (struct rhash *);
+bool rhash_empty (struct rhash *);
+
+/* Sample hash functions. */
+uint64_t rhash_bytes (const void *, size_t);
+uint64_t rhash_string (const char *);
+uint64_t rhash_int (uint64_t);
+
+#endif /* lib/kernel/rhash.h */
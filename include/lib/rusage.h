@@ -0,0 +1,23 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Number of buckets in the ready-queue wait histogram.  Bucket 0
+   counts waits that ended within the tick they began; bucket I,
+   for 0 < I < RUSAGE_WAIT_BUCKETS - 1, waits of 2**(I-1) up to
+   2**I - 1 ticks; and the last bucket everything longer. */
+#define RUSAGE_WAIT_BUCKETS 8
+
+/* Scheduling statistics of one thread, as returned by the
+   getrusage() system call.  Times are in timer ticks. */
+struct rusage {
+	int64_t utime;              /* Ticks running in user mode. */
+	int64_t stime;              /* Ticks running in the kernel. */
+	int64_t wait_time;          /* Ticks spent ready but not running. */
+	int64_t nvcsw;              /* Switches away because it blocked. */
+	int64_t nivcsw;             /* Switches away while still ready. */
+	int64_t wait_hist[RUSAGE_WAIT_BUCKETS];  /* Waits by length. */
+};
+
+#endif /* lib/rusage.h */
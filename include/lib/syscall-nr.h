@@ -36,6 +36,16 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Instrumentation. */
+	SYS_TRACE_DUMP,             /* Print the scheduler trace. */
+	SYS_GETRUSAGE,              /* Obtain a process's scheduling statistics. */
+
+	/* Real-time scheduling. */
+	SYS_SCHED_DEADLINE,         /* Reserve CPU time by deadline. */
+
+	/* Clocks. */
+	SYS_CLOCK_GETTIME,          /* Read a high-resolution clock. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <rusage.h>
+#include <time.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -50,6 +52,16 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Instrumentation. */
+void trace_dump (void);
+int getrusage (pid_t, struct rusage *);
+
+/* Real-time scheduling. */
+int sched_deadline (int runtime, int deadline, int period);
+
+/* Clocks. */
+int clock_gettime (int clock, struct timespec *);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -25,6 +25,11 @@
 #define LOADER_ARGS (LOADER_SIG - LOADER_ARGS_LEN)     /* Command-line args. */
 #define LOADER_ARG_CNT (LOADER_ARGS - LOADER_ARG_CNT_LEN) /* Number of args. */
 
+/* Physical address the application processors start executing
+   at, in real mode.  Must be page-aligned and below 1 MB.  See
+   threads/trampoline.S. */
+#define AP_TRAMPOLINE 0x8000
+
 /* Sizes of loader data structures. */
 #define LOADER_SIG_LEN 2
 #define LOADER_ARGS_LEN 128
@@ -3,11 +3,23 @@
 
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+
+/* Number of block sizes, from 16 bytes to 1.5 kB. */
+#define MALLOC_CLASSES 14
+
+/* A thread's cache of free blocks, one stack per block size.
+   Allocated by malloc() the first time the thread uses it. */
+struct malloc_cache {
+	void *blocks[MALLOC_CLASSES];   /* Top block of each stack. */
+	uint8_t cnt[MALLOC_CLASSES];    /* Number of blocks in each. */
+};
 
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+void malloc_cache_flush (void);
 
 #endif /* threads/malloc.h */
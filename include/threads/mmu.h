@@ -8,6 +8,8 @@
 typedef bool pte_for_each_func (uint64_t *pte, void *va, void *aux);
 
 uint64_t *pml4e_walk (uint64_t *pml4, const uint64_t va, int create);
+bool pml4_map_large (uint64_t *pml4, uint64_t va, uint64_t pa,
+		uint64_t size, uint64_t flags);
 uint64_t *pml4_create (void);
 bool pml4_for_each (uint64_t *, pte_for_each_func *, void *);
 void pml4_destroy (uint64_t *pml4);
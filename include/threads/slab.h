@@ -0,0 +1,23 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.  See slab.c for details. */
+
+struct kmem_cache;
+
+/* Constructor run once on each object when its slab is created.
+   Objects must be freed back to their cache in the same,
+   constructed state. */
+typedef void kmem_ctor_func (void *obj);
+
+void slab_init (void);
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+                                      size_t align, kmem_ctor_func *);
+void *kmem_cache_alloc (struct kmem_cache *) __attribute__ ((malloc));
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_cache_shrink (struct kmem_cache *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
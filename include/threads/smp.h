@@ -0,0 +1,28 @@
+#ifndef THREADS_SMP_H
+#define THREADS_SMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Maximum number of CPUs we keep track of. */
+#define CPU_MAX 8
+
+/* A processor. */
+struct cpu {
+	int id;                     /* Index into cpus[]. */
+	uint8_t lapic_id;           /* Local APIC ID. */
+	volatile bool online;       /* Has it finished booting? */
+};
+
+/* Processors found in the ACPI MADT.  cpus[0] is the bootstrap
+   processor. */
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+
+/* -smp: Start the application processors? */
+extern bool smp_enabled;
+
+void smp_init (void);
+int smp_online_cnt (void);
+
+#endif /* threads/smp.h */
@@ -0,0 +1,29 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+/* switch_threads()'s stack frame: the callee-saved registers it
+   pushes, lowest address first, and its return address. */
+struct switch_threads_frame {
+	uint64_t r15;
+	uint64_t r14;
+	uint64_t r13;
+	uint64_t r12;
+	uint64_t rbp;
+	uint64_t rbx;
+	void (*rip) (void);
+};
+
+/* Saves the running thread's callee-saved registers on its stack
+   and its stack pointer in *CUR_RSP, then resumes the thread
+   whose stack pointer is NEXT_RSP. */
+void switch_threads (uint64_t *cur_rsp, uint64_t next_rsp);
+
+/* Entry point of a new thread's first switch: calls the function
+   in rbx with r12 and r13 as its two arguments. */
+void switch_entry (void);
+#endif
+
+#endif /* threads/switch.h */
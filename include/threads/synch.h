@@ -2,12 +2,14 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <rbtree.h>
 #include <stdbool.h>
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct rb_tree waiters;     /* Waiting threads, highest priority
+	                               first, FIFO among equals. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -20,6 +22,8 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	int donation;               /* Priority of the top waiter, if any. */
+	struct rb_elem held_elem;   /* Element in holder's held_locks. */
 };
 
 void lock_init (struct lock *);
@@ -38,9 +42,51 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Wait queue.
+
+   A place for threads to sleep until some condition they test
+   themselves becomes true.  Each waiter is either exclusive or
+   not: a wakeup rouses every non-exclusive waiter but only as
+   many exclusive ones as the waker asks for, so a resource that
+   only one waiter can use need not wake them all.  Waiters of
+   each kind are woken highest priority first, FIFO among equal
+   priorities, by their priority at the time they went to sleep. */
+struct wait_queue {
+	struct rb_tree shared;      /* Non-exclusive waiters. */
+	struct rb_tree exclusive;   /* Exclusive waiters. */
+};
+
+void wait_queue_init (struct wait_queue *);
+void wait_queue_sleep (struct wait_queue *, bool exclusive);
+int wait_queue_wake (struct wait_queue *, int nr_exclusive);
+bool wait_queue_empty (const struct wait_queue *);
+int wait_queue_top_priority (const struct wait_queue *);
+
+/* Reader-writer lock.
+
+   Any number of readers or a single writer may hold it at once.
+   A reader does not overtake a waiting writer of equal or higher
+   priority, so a stream of readers cannot starve writers. */
+struct rwlock {
+	int readers;                /* Number of readers holding it. */
+	struct thread *writer;      /* Writer holding it, if any. */
+	bool handoff;               /* Reserved for a woken writer? */
+	struct wait_queue read_waiters;   /* Waiting readers. */
+	struct wait_queue write_waiters;  /* Waiting writers. */
+};
+
+void rw_init (struct rwlock *);
+void rw_read_acquire (struct rwlock *);
+void rw_read_release (struct rwlock *);
+void rw_write_acquire (struct rwlock *);
+void rw_write_release (struct rwlock *);
+bool rw_write_held_by_current_thread (const struct rwlock *);
+
 // -----create----- //
 
-bool compare_semaphore_priority (const struct list_elem *a, const struct list_elem *b, void *aux);
+void sema_requeue (struct semaphore *, struct thread *);
+bool lock_update_donation (struct lock *);
+int lock_top_donation (struct rb_tree *held_locks);
 
 /* Optimization barrier.
  *
@@ -3,8 +3,12 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
+#include <rusage.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -82,6 +86,23 @@ typedef int tid_t;
  * the `magic' member of the running thread's `struct thread' is
  * set to THREAD_MAGIC.  Stack overflow will normally change this
  * value, triggering the assertion. */
+
+/* Upper bound on sizeof (struct thread), checked by thread_init().
+ * Anything large or rarely used belongs out of line. */
+#define THREAD_SIZE_MAX 1024
+
+/* A thread's scheduling statistics.  Counted in ticks and
+ * switches, which fit in 32 bits; thread_get_rusage() widens them
+ * into a struct rusage. */
+struct thread_rusage {
+	uint32_t utime;             /* Ticks running in user mode. */
+	uint32_t stime;             /* Ticks running in the kernel. */
+	uint32_t wait_time;         /* Ticks spent ready but not running. */
+	uint32_t nvcsw;             /* Switches away because it blocked. */
+	uint32_t nivcsw;            /* Switches away while still ready. */
+	uint32_t wait_hist[RUSAGE_WAIT_BUCKETS];  /* Waits by length. */
+};
+
 /* The `elem' member has a dual purpose.  It can be an element in
  * the run queue (thread.c), or it can be an element in a
  * semaphore wait list (synch.c).  It can be used these two ways
@@ -95,21 +116,51 @@ struct thread
 	enum thread_status status; /* Thread state. */
 	char name[16];			   /* Name (for debugging purposes). */
 	int priority;			   /* Priority. */
-	int64_t time_to_wakeup;	   /* Time to wake up (for sleeping thread) */
+	int queued_priority;	   /* Run queue level while THREAD_READY. */
+	struct timeout wakeup;	   /* Wakes the thread from timer_sleep(). */
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem; /* List element. */
 
 	/* priority scheduling */
-	int init_priority;				
-	struct lock *wait_on_lock;		
-	struct list donations;			
-	struct list_elem donation_elem; 
+	int init_priority;				/* Priority before donations. */
+	struct lock *wait_on_lock;		/* Lock being acquired, if any. */
+	struct rb_tree held_locks;		/* Held locks, top donation first. */
+	struct semaphore *wait_sema;	/* Semaphore blocked on, if any. */
+	struct rb_elem wait_elem;		/* Element in wait_sema's waiters. */
 
 	/* mlfqs */
 	int nice; 
 	int recent_cpu;
 	struct list_elem allelem;
+	bool mlfqs_dirty;			/* On the recent_cpu changed list? */
+	struct list_elem mlfqs_elem;	/* Recent_cpu changed list element. */
+	bool kworker;				/* Work queue worker?  Exempt from MLFQS. */
+
+	/* cfs */
+	int64_t vruntime;			/* Run time weighted by nice. */
+	struct rb_elem cfs_elem;	/* Run queue tree element. */
+
+	/* deadline */
+	int64_t dl_runtime;			/* Budget per period in ticks, or 0. */
+	int64_t dl_deadline;		/* Relative deadline, in ticks. */
+	int64_t dl_period;			/* Period, in ticks. */
+	int64_t dl_abs_deadline;	/* Current absolute deadline. */
+	int64_t dl_budget;			/* Budget left until then. */
+	bool dl_throttled;			/* Out of budget until replenished? */
+	struct rb_elem dl_elem;		/* Run queue tree element. */
+	struct timeout dl_timer;	/* Replenishes the budget. */
+
+	/* accounting */
+	struct thread_rusage rusage;	/* Scheduling statistics. */
+	int64_t ready_since;		/* Tick it last became ready. */
+
+	/* preemption */
+	int preempt_count;			/* preempt_disable() nesting depth. */
+	bool need_resched;			/* Preemption deferred until preempt_enable()? */
+
+	/* memory */
+	struct malloc_cache *malloc_cache;	/* Free blocks for malloc(), or null. */
 
 	struct thread* parent_t; 
 	struct list children_list; 
@@ -135,7 +186,7 @@ struct thread
 #endif
 
 	/* Owned by thread.c. */
-	struct intr_frame tf; /* Information for switching */
+	uint64_t rsp;		  /* Saved stack pointer while switched out. */
 	struct intr_frame ptf;
 	unsigned magic;		  /* Detects stack overflow. */
 };
@@ -145,10 +196,21 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler, which ignores
+   priorities and shares the CPU in proportion to weights derived
+   from each thread's nice value.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
+/* Maximum number of dead threads' pages kept for reuse by
+   thread_create(). */
+extern size_t thread_page_cache_max;
+
 void thread_init(void);
 void thread_start(void);
 
 void thread_tick(void);
+void thread_tick_idle(void);
 void thread_print_stats(void);
 
 typedef void thread_func(void *aux);
@@ -172,16 +234,24 @@ void thread_set_nice(int);
 int thread_get_recent_cpu(void);
 int thread_get_load_avg(void);
 
+void thread_get_rusage(struct thread *, struct rusage *);
+
+bool thread_set_deadline(int64_t runtime, int64_t deadline, int64_t period);
+
 void do_iret(struct intr_frame *tf);
 
 void thread_preemption(void);
+void thread_sleep(int64_t ticks);
+
+/* kernel preemption */
+void preempt_disable(void);
+void preempt_enable(void);
+bool preemptible(void);
+void preempt_schedule_irq(void);
 
 /* priority scheduling */
-bool compare_thread_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
-bool compare_donation_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
 void donate_priority(void);
-void remove_with_lock(struct lock *lock);
-void refresh_priority(void);
+void refresh_priority(struct thread *t);
 
 /* mlfqs */
 void mlfqs_priority(struct thread *t);
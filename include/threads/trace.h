@@ -0,0 +1,45 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* Scheduler event tracing.
+
+   Events go into a fixed-size ring buffer, overwriting the
+   oldest, with a time-stamp counter reading, the thread's tid and
+   priority, and one argument.  Recording is off unless the kernel
+   is booted with -trace, and compiling with -DNO_SCHED_TRACE
+   removes the hooks altogether.  trace_dump() prints the buffer
+   for utils/sched-trace to turn into a timeline. */
+
+/* Kinds of event. */
+enum trace_type {
+	TRACE_SWITCH,               /* Thread switched in; ARG: previous tid. */
+	TRACE_BLOCK,                /* Thread blocked. */
+	TRACE_UNBLOCK,              /* Thread made ready. */
+	TRACE_SLEEP,                /* Thread went to sleep; ARG: wakeup tick. */
+	TRACE_WAKE,                 /* Sleeping thread's timer expired. */
+	TRACE_DONATE,               /* Thread donated; ARG: lock holder's tid. */
+	TRACE_CONTEND,              /* Lock was held; ARG: holder's tid. */
+};
+
+/* -trace: Record scheduler events? */
+extern bool trace_enabled;
+
+#ifdef NO_SCHED_TRACE
+#define trace_record(TYPE, T, ARG) ((void) 0)
+#else
+#define trace_record(TYPE, T, ARG)                      \
+	do {                                                \
+		if (trace_enabled)                              \
+			trace_event ((TYPE), (T), (ARG));           \
+	} while (0)
+#endif
+
+void trace_event (enum trace_type, const struct thread *, int64_t arg);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
@@ -0,0 +1,78 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <rbtree.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "devices/timer.h"
+
+/* Work queues.
+
+   A work queue runs deferred work on a pool of kernel worker
+   threads, so that code which must not sleep or take long, such
+   as an interrupt handler, can hand work off, and so that
+   background jobs need not each hand-roll a thread and a loop.
+
+   A work item is a struct work embedded in the caller's own
+   structure, which the work function recovers with work_entry().
+   Queued items run highest priority first, FIFO among equal
+   priorities.  An item is queued at most once at a time: queuing
+   an item that is still pending does nothing.  A delayed work
+   item is queued by a timer timeout after a given number of
+   ticks. */
+
+struct work;
+struct workqueue;
+
+/* Runs work item W.  W may be queued again, or freed, from
+   within its own function. */
+typedef void work_func (struct work *w);
+
+/* Work item. */
+struct work {
+	struct rb_elem elem;        /* Element in the queue's pending tree. */
+	work_func *func;            /* Function to run. */
+	int priority;               /* Higher runs first. */
+	struct workqueue *wq;       /* Queue it was last queued on. */
+	bool pending;               /* Queued and not yet started? */
+};
+
+/* Work item queued after a delay. */
+struct delayed_work {
+	struct work work;           /* The work item proper. */
+	struct timeout timer;       /* Queues WORK when it fires. */
+};
+
+/* Converts pointer to work item WORK into a pointer to the
+   structure that WORK is embedded inside.  Supply the name of the
+   outer structure STRUCT and the member name MEMBER of the work
+   item. */
+#define work_entry(WORK, STRUCT, MEMBER)                \
+	((STRUCT *) ((uint8_t *) (WORK)                     \
+		- offsetof (STRUCT, MEMBER)))
+
+/* Shared queues.  system_wq's workers run at PRI_DEFAULT and
+   system_highpri_wq's at PRI_MAX. */
+extern struct workqueue *system_wq;
+extern struct workqueue *system_highpri_wq;
+
+void workqueue_init (void);
+struct workqueue *workqueue_create (const char *name, int workers,
+                                    int priority);
+
+void work_init (struct work *, work_func *, int priority);
+void delayed_work_init (struct delayed_work *, work_func *, int priority);
+
+bool queue_work (struct workqueue *, struct work *);
+bool queue_delayed_work (struct workqueue *, struct delayed_work *,
+                         int64_t delay);
+
+bool cancel_work (struct work *);
+bool cancel_delayed_work (struct delayed_work *);
+
+void flush_work (struct work *);
+void flush_delayed_work (struct delayed_work *);
+void flush_workqueue (struct workqueue *);
+
+#endif /* threads/workqueue.h */
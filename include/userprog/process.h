@@ -3,12 +3,17 @@
 
 #include "threads/thread.h"
 
+/* Number of slots in a process's file descriptor table.  Slots 0
+   and 1 are stdin and stdout. */
+#define FDT_MAX 128
+
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
+struct file **process_fdt (bool create);
 
 /* 추가 */
 void argument_stack(char **parse, int count, void **esp);
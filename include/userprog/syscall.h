@@ -3,9 +3,13 @@
 
 // * USERPROG 추가
 #include <stdbool.h>
+#include <time.h>
 #include "threads/thread.h"
+#include "threads/synch.h"
 
-struct lock filesys_lock;
+/* Serializes file system calls.  Reads share it; anything that
+   may modify the file system takes it exclusively. */
+extern struct rwlock filesys_lock;
 
 void syscall_init (void);
 
@@ -27,5 +31,8 @@ int write(int fd, const void *buffer, unsigned size);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+int getrusage (int pid, struct rusage *usage);
+int sched_deadline (int runtime, int deadline, int period);
+int clock_gettime (int clock, struct timespec *ts);
 
 #endif /* userprog/syscall.h */
\ No newline at end of file
@@ -23,10 +23,23 @@ typedef unsigned long elem_type;
 
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   Searches work on whole elements: an element with no bit of
+   the value sought is skipped in one comparison, and the first
+   bit that has it is found with a single count-trailing-zeros.
+
+   Bitmaps are mostly used to hand out free (false) bits, which
+   tend to pile up at the front as true ones.  HINT is a lower
+   bound on the index of the first false bit, so that a search for
+   false bits can start there instead of at the beginning.  Every
+   operation that clears a bit lowers it as needed, and setting
+   the bits at HINT raises it. */
 struct bitmap {
 	size_t bit_cnt;     /* Number of bits. */
 	elem_type *bits;    /* Elements that represent bits. */
+	size_t hint;        /* No false bit before this index. */
+	size_t cursor;      /* Where the next next-fit search starts. */
 };
 
 /* Returns the index of the element that contains the bit
@@ -63,6 +76,76 @@ last_mask (const struct bitmap *b) {
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns an elem_type with the CNT bits starting at bit OFS
+   turned on.  OFS + CNT must not exceed ELEM_BITS. */
+static inline elem_type
+run_mask (size_t ofs, size_t cnt) {
+	elem_type mask = cnt < ELEM_BITS ? ((elem_type) 1 << cnt) - 1 : (elem_type) -1;
+	return mask << ofs;
+}
+
+/* Returns the number of bits turned on in X.  (The kernel is not
+   linked with libgcc, which __builtin_popcountl() would call.) */
+static inline size_t
+popcount (elem_type x) {
+	x = x - ((x >> 1) & 0x5555555555555555UL);
+	x = (x & 0x3333333333333333UL) + ((x >> 2) & 0x3333333333333333UL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (x * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none. */
+static size_t
+find_bit (const struct bitmap *b, size_t start, size_t end, bool value) {
+	elem_type flip = value ? 0 : (elem_type) -1;
+	size_t idx = elem_idx (start);
+	size_t last = elem_cnt (end);
+	elem_type word;
+
+	if (start >= end)
+		return end;
+
+	/* Look for 1 bits in the elements, inverted if we want 0s,
+	   ignoring the bits before START in the first one. */
+	word = (b->bits[idx] ^ flip) & ~(bit_mask (start) - 1);
+	while (word == 0) {
+		if (++idx >= last)
+			return end;
+		word = b->bits[idx] ^ flip;
+	}
+	start = idx * ELEM_BITS + __builtin_ctzl (word);
+	return start < end ? start : end;
+}
+
+/* Returns the starting index of the first group of CNT
+   consecutive bits in B that are all set to VALUE and lie
+   between START and END, exclusive, or BITMAP_ERROR if there is
+   none. */
+static size_t
+scan_range (const struct bitmap *b, size_t start, size_t end, size_t cnt,
+		bool value) {
+	if (cnt == 0)
+		return start <= end ? start : BITMAP_ERROR;
+	while (start <= end && end - start >= cnt) {
+		size_t first, stop;
+
+		/* A group can only begin at a bit set to VALUE... */
+		first = find_bit (b, start, end, value);
+		if (end - first < cnt)
+			break;
+
+		/* ...and is long enough if no bit in the next CNT breaks
+		   it.  Otherwise, the next group begins past the one that
+		   does. */
+		stop = find_bit (b, first, first + cnt, !value);
+		if (stop == first + cnt)
+			return first;
+		start = stop + 1;
+	}
+	return BITMAP_ERROR;
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -74,6 +157,7 @@ bitmap_create (size_t bit_cnt) {
 	struct bitmap *b = malloc (sizeof *b);
 	if (b != NULL) {
 		b->bit_cnt = bit_cnt;
+		b->hint = b->cursor = 0;
 		b->bits = malloc (byte_cnt (bit_cnt));
 		if (b->bits != NULL || bit_cnt == 0) {
 			bitmap_set_all (b, false);
@@ -95,6 +179,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED) {
 
 	b->bit_cnt = bit_cnt;
 	b->bits = (elem_type *) (b + 1);
+	b->hint = b->cursor = 0;
 	bitmap_set_all (b, false);
 	return b;
 }
@@ -148,6 +233,8 @@ bitmap_mark (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the OR instruction in [IA32-v2b]. */
 	asm ("lock orq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	if (bit_idx == b->hint)
+		b->hint++;
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -160,6 +247,8 @@ bitmap_reset (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the AND instruction in [IA32-v2a]. */
 	asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+	if (bit_idx < b->hint)
+		b->hint = bit_idx;
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -174,6 +263,8 @@ bitmap_flip (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the XOR instruction in [IA32-v2b]. */
 	asm ("lock xorq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	if (bit_idx < b->hint)
+		b->hint = bit_idx;
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -194,50 +285,71 @@ bitmap_set_all (struct bitmap *b, bool value) {
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, one at a time. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
+	size_t end = start + cnt;
 	size_t i;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	for (i = start; i < end; ) {
+		size_t ofs = i % ELEM_BITS;
+		size_t n = ELEM_BITS - ofs < end - i ? ELEM_BITS - ofs : end - i;
+		elem_type mask = run_mask (ofs, n);
+		elem_type *elem = &b->bits[elem_idx (i)];
+
+		/* See bitmap_mark() and bitmap_reset(). */
+		if (value)
+			asm ("lock orq %1, %0" : "=m" (*elem) : "r" (mask) : "cc");
+		else
+			asm ("lock andq %1, %0" : "=m" (*elem) : "r" (~mask) : "cc");
+		i += n;
+	}
+
+	if (cnt > 0) {
+		if (!value && start < b->hint)
+			b->hint = start;
+		else if (value && start <= b->hint && end > b->hint)
+			b->hint = end;
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i, value_cnt;
+	size_t end = start + cnt;
+	size_t i, true_cnt;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
-	return value_cnt;
+	true_cnt = 0;
+	for (i = start; i < end; ) {
+		size_t ofs = i % ELEM_BITS;
+		size_t n = ELEM_BITS - ofs < end - i ? ELEM_BITS - ofs : end - i;
+
+		true_cnt += popcount (b->bits[elem_idx (i)]
+				& run_mask (ofs, n));
+		i += n;
+	}
+	return value ? true_cnt : cnt - true_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			return true;
-	return false;
+	return find_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -272,14 +384,10 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
-	if (cnt <= b->bit_cnt) {
-		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
-				return i;
-	}
-	return BITMAP_ERROR;
+	/* No group of false bits starts before the hint. */
+	if (!value && cnt > 0 && start < b->hint)
+		start = b->hint;
+	return scan_range (b, start, b->bit_cnt, cnt, value);
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -291,11 +399,43 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
    setting them. */
 size_t
 bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t idx = bitmap_scan (b, start, cnt, value);
+	size_t idx;
+
+	/* Move the hint up to the first false bit, so that it stays
+	   there if the group we flip starts with it. */
+	if (!value)
+		b->hint = find_bit (b, b->hint, b->bit_cnt, false);
+
+	idx = bitmap_scan (b, start, cnt, value);
 	if (idx != BITMAP_ERROR)
 		bitmap_set_multiple (b, idx, cnt, !value);
 	return idx;
 }
+
+/* Like bitmap_scan_and_flip(), but next-fit: the search starts
+   where the previous call's group ended, and wraps around to the
+   start of B if it reaches the end.  Spreads allocations over B
+   instead of crowding them at its start, and skips over the bits
+   that earlier calls took. */
+size_t
+bitmap_scan_and_flip_next (struct bitmap *b, size_t cnt, bool value) {
+	size_t start, idx;
+
+	ASSERT (b != NULL);
+
+	start = b->cursor < b->bit_cnt ? b->cursor : 0;
+	idx = scan_range (b, start, b->bit_cnt, cnt, value);
+	if (idx == BITMAP_ERROR && start > 0) {
+		/* Groups that end at or after START were seen already. */
+		size_t end = start + cnt - 1 < b->bit_cnt ? start + cnt - 1 : b->bit_cnt;
+		idx = scan_range (b, 0, end, cnt, value);
+	}
+	if (idx != BITMAP_ERROR) {
+		bitmap_set_multiple (b, idx, cnt, !value);
+		b->cursor = idx + cnt;
+	}
+	return idx;
+}
 
 /* File input and output. */
 
@@ -315,6 +455,7 @@ bitmap_read (struct bitmap *b, struct file *file) {
 		off_t size = byte_cnt (b->bit_cnt);
 		success = file_read_at (file, b->bits, size, 0) == size;
 		b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+		b->hint = b->cursor = 0;
 	}
 	return success;
 }
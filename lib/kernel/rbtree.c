@@ -0,0 +1,292 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* A red-black tree is a binary search tree in which
+   every node is colored red or black and:
+
+   1. The root is black.
+   2. A red node has no red child.
+   3. Every path from a node down to a null leaf passes through
+      the same number of black nodes.
+
+   Together these keep the longest path no more than twice the
+   shortest, so the height is O(lg n).  See [CLRS] chapter 13;
+   the insertion and deletion fix-ups below follow it, using null
+   pointers (which count as black) instead of a sentinel. */
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void replace_child (struct rb_tree *, struct rb_elem *parent,
+		struct rb_elem *old, struct rb_elem *new);
+
+/* Returns true if E is red.  Null leaves are black. */
+static inline bool
+is_red (const struct rb_elem *e) {
+	return e != NULL && e->red;
+}
+
+/* Initializes TREE as an empty tree. */
+void
+rb_init (struct rb_tree *tree) {
+	ASSERT (tree != NULL);
+	tree->root = NULL;
+	tree->min = NULL;
+}
+
+/* Inserts ELEM into TREE, which must be ordered according to
+   LESS given auxiliary data AUX.  ELEM is placed after every
+   element that compares equal to it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_elem *elem,
+		rb_less_func *less, void *aux) {
+	struct rb_elem *parent = NULL;
+	struct rb_elem **link = &tree->root;
+	bool leftmost = true;
+
+	ASSERT (tree != NULL);
+	ASSERT (elem != NULL);
+	ASSERT (less != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		if (less (elem, parent, aux))
+			link = &parent->left;
+		else {
+			link = &parent->right;
+			leftmost = false;
+		}
+	}
+	elem->parent = parent;
+	elem->left = elem->right = NULL;
+	elem->red = true;
+	*link = elem;
+	if (leftmost)
+		tree->min = elem;
+
+	/* Restore property 2. */
+	while (is_red (elem->parent)) {
+		struct rb_elem *p = elem->parent;
+		struct rb_elem *g = p->parent;
+
+		if (p == g->left) {
+			struct rb_elem *uncle = g->right;
+			if (is_red (uncle)) {
+				p->red = uncle->red = false;
+				g->red = true;
+				elem = g;
+			} else {
+				if (elem == p->right) {
+					rotate_left (tree, p);
+					elem = p;
+					p = elem->parent;
+				}
+				p->red = false;
+				g->red = true;
+				rotate_right (tree, g);
+			}
+		} else {
+			struct rb_elem *uncle = g->left;
+			if (is_red (uncle)) {
+				p->red = uncle->red = false;
+				g->red = true;
+				elem = g;
+			} else {
+				if (elem == p->left) {
+					rotate_right (tree, p);
+					elem = p;
+					p = elem->parent;
+				}
+				p->red = false;
+				g->red = true;
+				rotate_left (tree, g);
+			}
+		}
+	}
+	tree->root->red = false;
+}
+
+/* Removes ELEM, which must be in TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_elem *elem) {
+	struct rb_elem *child, *parent;
+	bool removed_red;
+
+	ASSERT (tree != NULL);
+	ASSERT (elem != NULL);
+
+	if (tree->min == elem)
+		tree->min = rb_next (elem);
+
+	if (elem->left == NULL || elem->right == NULL) {
+		/* At most one child: splice ELEM out. */
+		child = elem->left != NULL ? elem->left : elem->right;
+		parent = elem->parent;
+		removed_red = elem->red;
+		replace_child (tree, parent, elem, child);
+		if (child != NULL)
+			child->parent = parent;
+	} else {
+		/* Two children: move ELEM's successor, which has no left
+		   child, into ELEM's place. */
+		struct rb_elem *succ = elem->right;
+		while (succ->left != NULL)
+			succ = succ->left;
+
+		child = succ->right;
+		removed_red = succ->red;
+		if (succ->parent == elem)
+			parent = succ;
+		else {
+			parent = succ->parent;
+			parent->left = child;
+			if (child != NULL)
+				child->parent = parent;
+			succ->right = elem->right;
+			succ->right->parent = succ;
+		}
+		succ->left = elem->left;
+		succ->left->parent = succ;
+		succ->red = elem->red;
+		replace_child (tree, elem->parent, elem, succ);
+		succ->parent = elem->parent;
+	}
+
+	if (removed_red)
+		return;
+
+	/* A black node was removed from below PARENT: restore
+	   property 3 along CHILD's path. */
+	while (child != tree->root && !is_red (child)) {
+		if (child == parent->left) {
+			struct rb_elem *sib = parent->right;
+			if (is_red (sib)) {
+				sib->red = false;
+				parent->red = true;
+				rotate_left (tree, parent);
+				sib = parent->right;
+			}
+			if (!is_red (sib->left) && !is_red (sib->right)) {
+				sib->red = true;
+				child = parent;
+				parent = child->parent;
+			} else {
+				if (!is_red (sib->right)) {
+					sib->left->red = false;
+					sib->red = true;
+					rotate_right (tree, sib);
+					sib = parent->right;
+				}
+				sib->red = parent->red;
+				parent->red = false;
+				sib->right->red = false;
+				rotate_left (tree, parent);
+				child = tree->root;
+				break;
+			}
+		} else {
+			struct rb_elem *sib = parent->left;
+			if (is_red (sib)) {
+				sib->red = false;
+				parent->red = true;
+				rotate_right (tree, parent);
+				sib = parent->left;
+			}
+			if (!is_red (sib->left) && !is_red (sib->right)) {
+				sib->red = true;
+				child = parent;
+				parent = child->parent;
+			} else {
+				if (!is_red (sib->left)) {
+					sib->right->red = false;
+					sib->red = true;
+					rotate_left (tree, sib);
+					sib = parent->left;
+				}
+				sib->red = parent->red;
+				parent->red = false;
+				sib->left->red = false;
+				rotate_right (tree, parent);
+				child = tree->root;
+				break;
+			}
+		}
+	}
+	if (child != NULL)
+		child->red = false;
+}
+
+/* Returns the smallest element in TREE, or a null pointer if
+   TREE is empty.  Among equal elements, this is the one inserted
+   first. */
+struct rb_elem *
+rb_min (const struct rb_tree *tree) {
+	ASSERT (tree != NULL);
+	return tree->min;
+}
+
+/* Returns the element that follows ELEM in its tree's order, or
+   a null pointer if ELEM is the largest. */
+struct rb_elem *
+rb_next (struct rb_elem *elem) {
+	ASSERT (elem != NULL);
+
+	if (elem->right != NULL) {
+		elem = elem->right;
+		while (elem->left != NULL)
+			elem = elem->left;
+		return elem;
+	}
+	while (elem->parent != NULL && elem == elem->parent->right)
+		elem = elem->parent;
+	return elem->parent;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree) {
+	ASSERT (tree != NULL);
+	return tree->root == NULL;
+}
+
+/* Makes NEW take OLD's place as a child of PARENT, or as the root
+   of TREE if PARENT is null.  Does not update NEW's parent. */
+static void
+replace_child (struct rb_tree *tree, struct rb_elem *parent,
+		struct rb_elem *old, struct rb_elem *new) {
+	if (parent == NULL)
+		tree->root = new;
+	else if (parent->left == old)
+		parent->left = new;
+	else
+		parent->right = new;
+}
+
+/* Rotates the subtree rooted at X to the left, making X's right
+   child its parent. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_elem *x) {
+	struct rb_elem *y = x->right;
+
+	x->right = y->left;
+	if (y->left != NULL)
+		y->left->parent = x;
+	y->parent = x->parent;
+	replace_child (tree, x->parent, x, y);
+	y->left = x;
+	x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, making X's left
+   child its parent. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_elem *x) {
+	struct rb_elem *y = x->left;
+
+	x->left = y->right;
+	if (y->right != NULL)
+		y->right->parent = x;
+	y->parent = x->parent;
+	replace_child (tree, x->parent, x, y);
+	y->right = x;
+	x->parent = y;
+}
@@ -0,0 +1,509 @@
+/* Open-addressing hash table.
+
+   See rhash.h for basic information.
+
+   The table is an array of SLOT_CNT pointers to elements, a power
+   of 2.  An element with hash value H belongs in slot H mod
+   SLOT_CNT, its "home"; if that is taken, it goes in the next
+   free slot after it, wrapping around at the end.  Its distance
+   from home is its "probe distance".
+
+   Insertion keeps the table in Robin Hood order: while looking
+   for a free slot, a new element that has come further than the
+   element in a slot takes that slot, and the displaced element
+   continues the search instead.  That keeps probe distances
+   short and even.  It also means that a search can stop as soon
+   as it reaches an element closer to its home than the element
+   sought would be to its own, because that element would have
+   been displaced.  Deletion shifts the elements that follow back
+   by one slot, up to the first one that is at home or an empty
+   slot, so the table never holds deleted markers.
+
+   The table grows to twice its size once it is 7/8 full.
+   Rather than moving every element at once, which for a large
+   table would stall whoever happened to trip the limit, the old
+   table is kept, and every later operation moves the elements in
+   the next MOVE_STEP of its slots to the new one.  Meanwhile,
+   new elements go in the new table, and searches look in both.
+   An element moved or deleted from the old table leaves a
+   TOMBSTONE behind, so that the searches for the elements after
+   it in the old table still reach them. */
+
+#include "rhash.h"
+#include "../debug.h"
+#include <string.h>
+#include "threads/malloc.h"
+
+/* Initial number of slots. */
+#define INIT_SLOTS 8
+
+/* Old slots emptied by each operation while a table grows. */
+#define MOVE_STEP 8
+
+/* Marks a slot of the old table that no longer holds an element,
+   but that searches must go past. */
+static struct rhash_elem tombstone;
+#define TOMBSTONE (&tombstone)
+
+static struct rhash_elem **find_slot (struct rhash *, struct rhash_elem *,
+		bool *old);
+static void insert_elem (struct rhash *, struct rhash_elem *);
+static void remove_slot (struct rhash *, struct rhash_elem **, bool old);
+static void move_some (struct rhash *, size_t cnt);
+static struct rhash_elem *slot_elem (const struct rhash *, size_t slot);
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using LESS, given auxiliary data AUX. */
+bool
+rhash_init (struct rhash *h,
+		rhash_hash_func *hash, rhash_less_func *less, void *aux) {
+	h->elem_cnt = 0;
+	h->slot_cnt = INIT_SLOTS;
+	h->slots = calloc (h->slot_cnt, sizeof *h->slots);
+	h->old_slot_cnt = 0;
+	h->old_slots = NULL;
+	h->moved = 0;
+	h->hash = hash;
+	h->less = less;
+	h->aux = aux;
+
+	return h->slots != NULL;
+}
+
+/* Removes all the elements from H.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the hash.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the hash element.  However, modifying hash
+   table H while rhash_clear() is running, using any of the
+   functions rhash_clear(), rhash_destroy(), rhash_insert(),
+   rhash_replace(), or rhash_delete(), yields undefined behavior,
+   whether done in DESTRUCTOR or elsewhere. */
+void
+rhash_clear (struct rhash *h, rhash_action_func *destructor) {
+	if (destructor != NULL)
+		rhash_apply (h, destructor);
+
+	free (h->old_slots);
+	h->old_slots = NULL;
+	h->old_slot_cnt = 0;
+	memset (h->slots, 0, h->slot_cnt * sizeof *h->slots);
+	h->elem_cnt = 0;
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the hash.  DESTRUCTOR may, if appropriate,
+   deallocate the memory used by the hash element.  However,
+   modifying hash table H while rhash_clear() is running, using
+   any of the functions rhash_clear(), rhash_destroy(),
+   rhash_insert(), rhash_replace(), or rhash_delete(), yields
+   undefined behavior, whether done in DESTRUCTOR or
+   elsewhere. */
+void
+rhash_destroy (struct rhash *h, rhash_action_func *destructor) {
+	if (destructor != NULL)
+		rhash_apply (h, destructor);
+	free (h->old_slots);
+	free (h->slots);
+}
+
+/* Inserts NEW into hash table H and returns a null pointer, if
+   no equal element is already in the table.
+   If an equal element is already in the table, returns it
+   without inserting NEW.
+   Panics if the table is full and memory to grow it is not
+   available. */
+struct rhash_elem *
+rhash_insert (struct rhash *h, struct rhash_elem *new) {
+	struct rhash_elem **slot;
+	bool old;
+
+	move_some (h, MOVE_STEP);
+	new->hash = h->hash (new, h->aux);
+	slot = find_slot (h, new, &old);
+	if (slot != NULL)
+		return *slot;
+
+	insert_elem (h, new);
+	return NULL;
+}
+
+/* Inserts NEW into hash table H, replacing any equal element
+   already in the table, which is returned. */
+struct rhash_elem *
+rhash_replace (struct rhash *h, struct rhash_elem *new) {
+	struct rhash_elem **slot;
+	struct rhash_elem *found;
+	bool old;
+
+	move_some (h, MOVE_STEP);
+	new->hash = h->hash (new, h->aux);
+	slot = find_slot (h, new, &old);
+	if (slot == NULL) {
+		insert_elem (h, new);
+		return NULL;
+	}
+
+	/* Equal elements hash alike, so NEW belongs in the same slot. */
+	found = *slot;
+	*slot = new;
+	return found;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table. */
+struct rhash_elem *
+rhash_find (struct rhash *h, struct rhash_elem *e) {
+	struct rhash_elem **slot;
+	bool old;
+
+	move_some (h, MOVE_STEP);
+	e->hash = h->hash (e, h->aux);
+	slot = find_slot (h, e, &old);
+	return slot != NULL ? *slot : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table.
+
+   If the elements of the hash table are dynamically allocated,
+   or own resources that are, then it is the caller's
+   responsibility to deallocate them. */
+struct rhash_elem *
+rhash_delete (struct rhash *h, struct rhash_elem *e) {
+	struct rhash_elem **slot;
+	struct rhash_elem *found;
+	bool old;
+
+	move_some (h, MOVE_STEP);
+	e->hash = h->hash (e, h->aux);
+	slot = find_slot (h, e, &old);
+	if (slot == NULL)
+		return NULL;
+
+	found = *slot;
+	remove_slot (h, slot, old);
+	h->elem_cnt--;
+	return found;
+}
+
+/* Calls ACTION for each element in hash table H in arbitrary
+   order.
+   Modifying hash table H while rhash_apply() is running, using
+   any of the functions rhash_clear(), rhash_destroy(),
+   rhash_insert(), rhash_replace(), or rhash_delete(), yields
+   undefined behavior, whether done from ACTION or elsewhere. */
+void
+rhash_apply (struct rhash *h, rhash_action_func *action) {
+	size_t i;
+
+	ASSERT (action != NULL);
+
+	for (i = 0; i < h->old_slot_cnt + h->slot_cnt; i++) {
+		struct rhash_elem *e = slot_elem (h, i);
+		if (e != NULL)
+			action (e, h->aux);
+	}
+}
+
+/* Initializes I for iterating hash table H.
+
+   Iteration idiom:
+
+   struct rhash_iterator i;
+
+   rhash_first (&i, h);
+   while (rhash_next (&i))
+   {
+   struct foo *f = rhash_entry (rhash_cur (&i), struct foo, elem);
+   ...do something with f...
+   }
+
+   Modifying hash table H during iteration, using any of the
+   functions rhash_clear(), rhash_destroy(), rhash_insert(),
+   rhash_replace(), rhash_find() or rhash_delete(), invalidates
+   all iterators.  (rhash_find() may move elements while the
+   table grows.) */
+void
+rhash_first (struct rhash_iterator *i, struct rhash *h) {
+	ASSERT (i != NULL);
+	ASSERT (h != NULL);
+
+	i->hash = h;
+	i->slot = SIZE_MAX;
+	i->elem = NULL;
+}
+
+/* Advances I to the next element in the hash table and returns
+   it.  Returns a null pointer if no elements are left.  Elements
+   are returned in arbitrary order. */
+struct rhash_elem *
+rhash_next (struct rhash_iterator *i) {
+	struct rhash *h;
+
+	ASSERT (i != NULL);
+
+	h = i->hash;
+	i->elem = NULL;
+	while (++i->slot < h->old_slot_cnt + h->slot_cnt) {
+		i->elem = slot_elem (h, i->slot);
+		if (i->elem != NULL)
+			break;
+	}
+	if (i->slot >= h->old_slot_cnt + h->slot_cnt)
+		i->slot = h->old_slot_cnt + h->slot_cnt;
+
+	return i->elem;
+}
+
+/* Returns the current element in the hash table iteration, or a
+   null pointer at the end of the table.  Undefined behavior
+   after calling rhash_first() but before rhash_next(). */
+struct rhash_elem *
+rhash_cur (struct rhash_iterator *i) {
+	return i->elem;
+}
+
+/* Returns the number of elements in H. */
+size_t
+rhash_size (struct rhash *h) {
+	return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+rhash_empty (struct rhash *h) {
+	return h->elem_cnt == 0;
+}
+
+/* Multiplication constants for rhash_bytes(), taken from
+   wyhash. */
+#define RHASH_P0 0xa0761d6478bd642fULL
+#define RHASH_P1 0xe7037ed1a0b428dbULL
+#define RHASH_P2 0x8ebc6af09c88c6e3ULL
+
+/* Returns the 128-bit product of A and B, folded to 64 bits. */
+static inline uint64_t
+mum (uint64_t a, uint64_t b) {
+	unsigned __int128 p = (unsigned __int128) a * b;
+	return (uint64_t) p ^ (uint64_t) (p >> 64);
+}
+
+/* Returns a hash of the SIZE bytes in BUF.
+
+   Unlike hash_bytes(), which multiplies once per byte, this
+   mixes in 8 bytes at a time with one 64x64-to-128-bit
+   multiplication. */
+uint64_t
+rhash_bytes (const void *buf_, size_t size) {
+	const uint8_t *buf = buf_;
+	uint64_t hash = RHASH_P0 ^ size;
+	uint64_t word;
+
+	ASSERT (buf != NULL);
+
+	for (; size >= 8; buf += 8, size -= 8) {
+		__builtin_memcpy (&word, buf, 8);
+		hash = mum (word ^ RHASH_P1, hash ^ RHASH_P2);
+	}
+	for (word = 0; size > 0; size--)
+		word = (word << 8) | buf[size - 1];
+	hash = mum (word ^ RHASH_P1, hash ^ RHASH_P2);
+
+	return mum (hash, RHASH_P0);
+}
+
+/* Returns a hash of string S. */
+uint64_t
+rhash_string (const char *s) {
+	ASSERT (s != NULL);
+
+	return rhash_bytes (s, strlen (s));
+}
+
+/* Returns a hash of integer I.  This is the finalizer of
+   MurmurHash3, which mixes every bit of I into every bit of the
+   result, so keys such as page addresses, whose low bits are all
+   zero, spread evenly over the slots. */
+uint64_t
+rhash_int (uint64_t i) {
+	i ^= i >> 33;
+	i *= 0xff51afd7ed558ccdULL;
+	i ^= i >> 33;
+	i *= 0xc4ceb9fe1a85ec53ULL;
+	i ^= i >> 33;
+	return i;
+}
+
+/* Returns the element in slot number SLOT of H, counting the old
+   table's slots first, or a null pointer if it has none. */
+static struct rhash_elem *
+slot_elem (const struct rhash *h, size_t slot) {
+	struct rhash_elem *e;
+
+	if (slot < h->old_slot_cnt)
+		e = h->old_slots[slot];
+	else
+		e = h->slots[slot - h->old_slot_cnt];
+	return e != TOMBSTONE ? e : NULL;
+}
+
+/* Returns the distance of element E in slot SLOT from its home,
+   in a table with MASK + 1 slots. */
+static inline size_t
+probe_dist (const struct rhash_elem *e, size_t slot, size_t mask) {
+	return (slot - e->hash) & mask;
+}
+
+/* Searches the SLOT_CNT slots at SLOTS for an element equal to
+   E, whose hash value must be set.  Returns its slot, or a null
+   pointer if there is none. */
+static struct rhash_elem **
+table_find (const struct rhash *h, struct rhash_elem **slots,
+		size_t slot_cnt, struct rhash_elem *e) {
+	size_t mask = slot_cnt - 1;
+	size_t slot = e->hash & mask;
+	size_t dist;
+
+	for (dist = 0; ; dist++, slot = (slot + 1) & mask) {
+		struct rhash_elem *cur = slots[slot];
+
+		if (cur == NULL)
+			return NULL;
+		if (cur == TOMBSTONE)
+			continue;
+		if (probe_dist (cur, slot, mask) < dist)
+			return NULL;
+		if (cur->hash == e->hash
+				&& !h->less (cur, e, h->aux) && !h->less (e, cur, h->aux))
+			return &slots[slot];
+	}
+}
+
+/* Searches H for an element equal to E, whose hash value must be
+   set.  Returns its slot, or a null pointer if there is none.
+   Sets *OLD to true if the slot is in the old table. */
+static struct rhash_elem **
+find_slot (struct rhash *h, struct rhash_elem *e, bool *old) {
+	struct rhash_elem **slot;
+
+	*old = false;
+	slot = table_find (h, h->slots, h->slot_cnt, e);
+	if (slot == NULL && h->old_slots != NULL) {
+		*old = true;
+		slot = table_find (h, h->old_slots, h->old_slot_cnt, e);
+	}
+	return slot;
+}
+
+/* Puts E, whose hash value must be set, in the table of SLOT_CNT
+   slots at SLOTS, which must have a free slot and no
+   tombstones. */
+static void
+table_put (struct rhash_elem **slots, size_t slot_cnt,
+		struct rhash_elem *e) {
+	size_t mask = slot_cnt - 1;
+	size_t slot = e->hash & mask;
+	size_t dist;
+
+	for (dist = 0; ; dist++, slot = (slot + 1) & mask) {
+		struct rhash_elem *cur = slots[slot];
+		size_t cur_dist;
+
+		if (cur == NULL) {
+			slots[slot] = e;
+			return;
+		}
+
+		/* Take the slot from an element closer to its home, and
+		   find a new one for that element instead. */
+		cur_dist = probe_dist (cur, slot, mask);
+		if (cur_dist < dist) {
+			slots[slot] = e;
+			e = cur;
+			dist = cur_dist;
+		}
+	}
+}
+
+/* Starts moving H's elements to a table twice the size.  Returns
+   false if memory is not available. */
+static bool
+grow (struct rhash *h) {
+	struct rhash_elem **slots;
+
+	/* Finish the previous move first. */
+	move_some (h, SIZE_MAX);
+
+	slots = calloc (h->slot_cnt * 2, sizeof *slots);
+	if (slots == NULL)
+		return false;
+	h->old_slots = h->slots;
+	h->old_slot_cnt = h->slot_cnt;
+	h->moved = 0;
+	h->slots = slots;
+	h->slot_cnt *= 2;
+	return true;
+}
+
+/* Inserts E, whose hash value must be set, into H. */
+static void
+insert_elem (struct rhash *h, struct rhash_elem *e) {
+	if (h->elem_cnt + 1 > h->slot_cnt / 8 * 7
+			&& !grow (h) && h->elem_cnt + 1 >= h->slot_cnt)
+		PANIC ("rhash: table full and out of memory");
+
+	table_put (h->slots, h->slot_cnt, e);
+	h->elem_cnt++;
+}
+
+/* Empties SLOT of H, which is in the old table if OLD. */
+static void
+remove_slot (struct rhash *h, struct rhash_elem **slot, bool old) {
+	size_t mask = h->slot_cnt - 1;
+	size_t i;
+
+	if (old) {
+		*slot = TOMBSTONE;
+		return;
+	}
+
+	/* Shift the elements that follow back by one, up to one that
+	   is at home or an empty slot. */
+	for (i = slot - h->slots; ; i = (i + 1) & mask) {
+		size_t next = (i + 1) & mask;
+		struct rhash_elem *cur = h->slots[next];
+
+		if (cur == NULL || probe_dist (cur, next, mask) == 0) {
+			h->slots[i] = NULL;
+			return;
+		}
+		h->slots[i] = cur;
+	}
+}
+
+/* Moves the elements in up to CNT more slots of H's old table, if
+   it has one, to the new table.  Frees the old table once it is
+   empty. */
+static void
+move_some (struct rhash *h, size_t cnt) {
+	if (h->old_slots == NULL)
+		return;
+
+	for (; cnt > 0 && h->moved < h->old_slot_cnt; cnt--) {
+		struct rhash_elem **slot = &h->old_slots[h->moved++];
+
+		if (*slot != NULL && *slot != TOMBSTONE)
+			table_put (h->slots, h->slot_cnt, *slot);
+		*slot = TOMBSTONE;
+	}
+
+	if (h->moved == h->old_slot_cnt) {
+		free (h->old_slots);
+		h->old_slots = NULL;
+		h->old_slot_cnt = 0;
+	}
+}
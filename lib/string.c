@@ -1,5 +1,67 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The block functions below move data with the x86 string
+   instructions.  With the direction flag clear, as it is on
+   entry to every function, "rep movsq" and "rep stosq" copy or
+   store RCX quad words, from RSI to RDI or from RAX to RDI, and
+   leave RSI and RDI just past the end; the "b" forms work on
+   bytes.  The kernel is built with -mno-sse, so these are the
+   widest stores it has.
+
+   Blocks of at least WIDE_MIN bytes are done in three steps:
+   bytes up to an 8-byte boundary in DST, then as many quad words
+   as fit, then the remaining bytes.  Smaller blocks are done
+   bytewise. */
+#define WIDE_MIN 16
+
+/* Copies SIZE bytes from SRC to DST, lowest address first. */
+static inline void
+copy_up (unsigned char *dst, const unsigned char *src, size_t size) {
+	if (size >= WIDE_MIN) {
+		size_t head = -(uintptr_t) dst & 7;
+		size_t quads = (size - head) / 8;
+
+		size = (size - head) % 8;
+		asm volatile ("rep movsb\n\t"
+				"mov %3, %%rcx\n\t"
+				"rep movsq"
+				: "+D" (dst), "+S" (src), "+c" (head)
+				: "r" (quads)
+				: "memory");
+	}
+	asm volatile ("rep movsb"
+			: "+D" (dst), "+S" (src), "+c" (size)
+			:
+			: "memory");
+}
+
+/* Copies SIZE bytes from SRC to DST, highest address first. */
+static inline void
+copy_down (unsigned char *dst, const unsigned char *src, size_t size) {
+	size_t tail = size % 8;
+
+	dst += size - 1;
+	src += size - 1;
+
+	/* With the direction flag set, the string instructions count
+	   down from RSI and RDI instead.  Copy the odd bytes at the
+	   top first, then step back to the start of the last whole
+	   quad word and copy the rest a quad word at a time.  An
+	   interrupt handler clears the flag for itself, and iretq
+	   restores it. */
+	asm volatile ("std\n\t"
+			"rep movsb\n\t"
+			"sub $7, %%rsi\n\t"
+			"sub $7, %%rdi\n\t"
+			"mov %3, %%rcx\n\t"
+			"rep movsq\n\t"
+			"cld"
+			: "+D" (dst), "+S" (src), "+c" (tail)
+			: "r" (size / 8)
+			: "memory");
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -11,9 +73,7 @@ memcpy (void *dst_, const void *src_, size_t size) {
 	ASSERT (dst != NULL || size == 0);
 	ASSERT (src != NULL || size == 0);
 
-	while (size-- > 0)
-		*dst++ = *src++;
-
+	copy_up (dst, src, size);
 	return dst_;
 }
 
@@ -27,17 +87,13 @@ memmove (void *dst_, const void *src_, size_t size) {
 	ASSERT (dst != NULL || size == 0);
 	ASSERT (src != NULL || size == 0);
 
-	if (dst < src) {
-		while (size-- > 0)
-			*dst++ = *src++;
-	} else {
-		dst += size;
-		src += size;
-		while (size-- > 0)
-			*--dst = *--src;
-	}
+	/* Copying upward is safe unless DST starts inside SRC. */
+	if (dst <= src || dst >= src + size)
+		copy_up (dst, src, size);
+	else
+		copy_down (dst, src, size);
 
-	return dst;
+	return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -52,6 +108,15 @@ memcmp (const void *a_, const void *b_, size_t size) {
 	ASSERT (a != NULL || size == 0);
 	ASSERT (b != NULL || size == 0);
 
+	/* Skip over equal quad words, then find the differing byte. */
+	for (; size >= 8; a += 8, b += 8, size -= 8) {
+		uint64_t wa, wb;
+
+		__builtin_memcpy (&wa, a, 8);
+		__builtin_memcpy (&wb, b, 8);
+		if (wa != wb)
+			break;
+	}
 	for (; size-- > 0; a++, b++)
 		if (*a != *b)
 			return *a > *b ? +1 : -1;
@@ -260,8 +325,23 @@ memset (void *dst_, int value, size_t size) {
 
 	ASSERT (dst != NULL || size == 0);
 
-	while (size-- > 0)
-		*dst++ = value;
+	if (size >= WIDE_MIN) {
+		size_t head = -(uintptr_t) dst & 7;
+		size_t quads = (size - head) / 8;
+		uint64_t pattern = (unsigned char) value * 0x0101010101010101ULL;
+
+		size = (size - head) % 8;
+		asm volatile ("rep stosb\n\t"
+				"mov %2, %%rcx\n\t"
+				"rep stosq"
+				: "+D" (dst), "+c" (head)
+				: "r" (quads), "a" (pattern)
+				: "memory");
+	}
+	asm volatile ("rep stosb"
+			: "+D" (dst), "+c" (size)
+			: "a" (value)
+			: "memory");
 
 	return dst_;
 }
@@ -194,3 +194,23 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+void
+trace_dump (void) {
+	syscall0 (SYS_TRACE_DUMP);
+}
+
+int
+getrusage (pid_t pid, struct rusage *usage) {
+	return syscall2 (SYS_GETRUSAGE, pid, usage);
+}
+
+int
+sched_deadline (int runtime, int deadline, int period) {
+	return syscall3 (SYS_SCHED_DEADLINE, runtime, deadline, period);
+}
+
+int
+clock_gettime (int clock, struct timespec *ts) {
+	return syscall2 (SYS_CLOCK_GETTIME, clock, ts);
+}
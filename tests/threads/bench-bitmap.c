@@ -0,0 +1,95 @@
+/* Measures bitmap searches on a large, fragmented map, as a free
+   map or swap map becomes after long use.  The map is filled with
+   runs of 1 to 64 true bits separated by holes of 1 to 8 false
+   bits, with a long false run only at its very end.  Then it
+   times:
+
+     - first-fit searches for 1 and 8 false bits, which usually
+       succeed near the start, and for 64, which must skip over
+       nearly the whole map;
+
+     - taking and giving back a single bit first-fit, and taking
+       single bits next-fit. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <bitmap.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "devices/hrtimer.h"
+
+#define BITS (1 << 20)
+#define TAIL 4096
+#define SCANS 200
+#define FLIPS 10000
+
+static void time_scan (const struct bitmap *, size_t cnt);
+
+void
+test_bench_bitmap (void) 
+{
+  struct bitmap *b = bitmap_create (BITS);
+  static size_t taken[FLIPS];
+  uint64_t start;
+  size_t i;
+  int j;
+
+  ASSERT (hrtimer_tsc_hz () != 0);
+  if (b == NULL)
+    fail ("cannot create a %d-bit map", BITS);
+
+  random_init (0);
+  for (i = 0; i < BITS - TAIL; ) 
+    {
+      size_t used = random_ulong () % 64 + 1;
+      size_t hole = random_ulong () % 8 + 1;
+
+      if (used > BITS - TAIL - i)
+        used = BITS - TAIL - i;
+      bitmap_set_multiple (b, i, used, true);
+      i += used + hole;
+    }
+
+  time_scan (b, 1);
+  time_scan (b, 8);
+  time_scan (b, 64);
+
+  start = hrtimer_now ();
+  for (j = 0; j < FLIPS; j++) 
+    {
+      size_t idx = bitmap_scan_and_flip (b, 0, 1, false);
+      if (idx == BITMAP_ERROR)
+        fail ("first-fit found no free bit");
+      bitmap_reset (b, idx);
+    }
+  msg ("First-fit take+give back of 1 bit: %"PRIu64" ns.",
+       (hrtimer_now () - start) / FLIPS);
+
+  start = hrtimer_now ();
+  for (j = 0; j < FLIPS; j++) 
+    {
+      taken[j] = bitmap_scan_and_flip_next (b, 1, false);
+      if (taken[j] == BITMAP_ERROR)
+        fail ("next-fit found no free bit");
+    }
+  msg ("Next-fit take of 1 bit: %"PRIu64" ns.",
+       (hrtimer_now () - start) / FLIPS);
+  for (j = 0; j < FLIPS; j++)
+    bitmap_reset (b, taken[j]);
+
+  bitmap_destroy (b);
+}
+
+/* Times SCANS first-fit searches of B for CNT false bits. */
+static void
+time_scan (const struct bitmap *b, size_t cnt) 
+{
+  uint64_t start = hrtimer_now ();
+  int i;
+
+  for (i = 0; i < SCANS; i++)
+    if (bitmap_scan (b, 0, cnt, false) == BITMAP_ERROR)
+      fail ("no run of %zu free bits", cnt);
+  msg ("%zu-bit first-fit scan: %"PRIu64" ns.", cnt,
+       (hrtimer_now () - start) / SCANS);
+}
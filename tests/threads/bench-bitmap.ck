@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+
+check_bench ('1-bit first-fit scan: \d+ ns\.',
+	     '8-bit first-fit scan: \d+ ns\.',
+	     '64-bit first-fit scan: \d+ ns\.',
+	     'First-fit take\+give back of 1 bit: \d+ ns\.',
+	     'Next-fit take of 1 bit: \d+ ns\.');
@@ -0,0 +1,71 @@
+/* Measures reads through the kernel's mapping of physical
+   memory, scattered over more pages than the TLB can hold, as
+   page-table walks, buffer cache lookups and copies between
+   processes do.  With 4 kB pages nearly every read misses the
+   TLB; with 2 MB pages the whole working set fits in a few
+   entries.  Reads that stay within one page are timed for
+   comparison. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/hrtimer.h"
+
+#define MAX_PAGES 4096
+#define READS 1000000
+
+static uint8_t *pages[MAX_PAGES];
+
+/* Returns the next value of a linear congruential generator. */
+static inline uint64_t
+next_random (uint64_t *state) 
+{
+  *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return *state >> 32;
+}
+
+/* Times READS reads of words at random offsets in the first
+   PAGE_CNT pages, and prints the time per read as NAME. */
+static void
+time_reads (const char *name, size_t page_cnt) 
+{
+  volatile uint64_t sum = 0;
+  uint64_t state = 1, start;
+  int i;
+
+  start = hrtimer_now ();
+  for (i = 0; i < READS; i++) 
+    {
+      uint64_t r = next_random (&state);
+      sum += *(uint64_t *) (pages[r % page_cnt] + (r >> 20) % PGSIZE / 8 * 8);
+    }
+  msg ("%s: %"PRIu64" ns.", name, (hrtimer_now () - start) / (READS / 1000));
+}
+
+void
+test_bench_direct_map (void) 
+{
+  size_t page_cnt, i;
+
+  ASSERT (hrtimer_tsc_hz () != 0);
+
+  /* Leave a quarter of the pool for the rest of the kernel. */
+  for (page_cnt = 0; page_cnt < MAX_PAGES; page_cnt++) 
+    {
+      if (palloc_free_cnt (0) < MAX_PAGES / 4)
+        break;
+      pages[page_cnt] = palloc_get_page (0);
+      if (pages[page_cnt] == NULL)
+        break;
+    }
+  if (page_cnt < MAX_PAGES / 4)
+    fail ("only %zu pages available", page_cnt);
+
+  time_reads ("1000 reads within one page", 1);
+  time_reads ("1000 reads across many pages", page_cnt);
+
+  for (i = 0; i < page_cnt; i++)
+    palloc_free_page (pages[i]);
+}
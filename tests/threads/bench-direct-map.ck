@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+
+check_bench ('1000 reads within one page: \d+ ns\.',
+	     '1000 reads across many pages: \d+ ns\.');
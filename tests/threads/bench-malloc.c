@@ -0,0 +1,114 @@
+/* Measures malloc() on the patterns that allocation-heavy kernel
+   paths produce: a tight malloc()/free() pair, as for a bounce
+   buffer; a batch of mixed-size objects freed in a different
+   order, as when a process opens and closes files; the same batch
+   run by several threads at once; and a buffer grown by realloc()
+   well past a page. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/hrtimer.h"
+
+#define PAIRS 20000
+#define BATCH 128
+#define BATCHES 400
+#define THREAD_CNT 4
+#define GROW_MAX (256 * 1024)
+#define GROWS 50
+
+static uint64_t time_batches (void);
+static void batch_thread (void *);
+
+static struct semaphore done;
+
+void
+test_bench_malloc (void) 
+{
+  static const size_t sizes[] = {24, 200, 1000};
+  uint64_t start;
+  size_t i;
+  int j;
+
+  ASSERT (hrtimer_tsc_hz () != 0);
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++) 
+    {
+      start = hrtimer_now ();
+      for (j = 0; j < PAIRS; j++)
+        free (malloc (sizes[i]));
+      msg ("%zu-byte malloc+free: %"PRIu64" ns.", sizes[i],
+           (hrtimer_now () - start) / PAIRS);
+    }
+
+  random_init (0);
+  msg ("Mixed batch, 1 thread: %"PRIu64" ns per object.",
+       time_batches () / (BATCHES * BATCH));
+
+  sema_init (&done, 0);
+  start = hrtimer_now ();
+  for (j = 0; j < THREAD_CNT; j++)
+    thread_create ("batch", PRI_DEFAULT, batch_thread, NULL);
+  for (j = 0; j < THREAD_CNT; j++)
+    sema_down (&done);
+  msg ("Mixed batch, %d threads: %"PRIu64" ns per object.", THREAD_CNT,
+       (hrtimer_now () - start) / (THREAD_CNT * BATCHES * BATCH));
+
+  start = hrtimer_now ();
+  for (j = 0; j < GROWS; j++) 
+    {
+      size_t size = 16;
+      void *p = malloc (size);
+
+      while (size < GROW_MAX) 
+        {
+          size += size / 2;
+          p = realloc (p, size);
+          if (p == NULL)
+            fail ("realloc to %zu bytes failed", size);
+        }
+      free (p);
+    }
+  msg ("realloc growth to %d kB: %"PRIu64" ns.", GROW_MAX / 1024,
+       (hrtimer_now () - start) / GROWS);
+}
+
+/* Allocates BATCH objects of random sizes up to 2 kB, frees them
+   in random order, and does it all BATCHES times.  Returns the
+   time taken in nanoseconds. */
+static uint64_t
+time_batches (void) 
+{
+  void *objs[BATCH];
+  uint64_t start = hrtimer_now ();
+  int i, j;
+
+  for (i = 0; i < BATCHES; i++) 
+    {
+      for (j = 0; j < BATCH; j++) 
+        {
+          objs[j] = malloc (random_ulong () % 2048 + 1);
+          if (objs[j] == NULL)
+            fail ("out of memory");
+        }
+      for (j = 0; j < BATCH; j++) 
+        {
+          int k = random_ulong () % (BATCH - j) + j;
+          void *tmp = objs[k];
+          objs[k] = objs[j];
+          free (tmp);
+        }
+    }
+  return hrtimer_now () - start;
+}
+
+static void
+batch_thread (void *aux UNUSED) 
+{
+  time_batches ();
+  sema_up (&done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+
+check_bench ('24-byte malloc\+free: \d+ ns\.',
+	     '200-byte malloc\+free: \d+ ns\.',
+	     '1000-byte malloc\+free: \d+ ns\.',
+	     'Mixed batch, 1 thread: \d+ ns per object\.',
+	     'Mixed batch, 4 threads: \d+ ns per object\.',
+	     'realloc growth to 256 kB: \d+ ns\.');
@@ -0,0 +1,102 @@
+/* Measures the block memory functions on whole pages, as fork,
+   swap and page-fault handling use them, and on the small,
+   often unaligned blocks that the file system and system calls
+   copy.  A plain byte-at-a-time loop is timed on a page alongside
+   them for reference. */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/hrtimer.h"
+
+#define PAGE_ITERS 2000
+#define SMALL_ITERS 100000
+
+static uint8_t *src, *dst;
+
+/* Copies SIZE bytes from SRC to DST one byte at a time. */
+static void
+byte_copy (uint8_t *dst, const uint8_t *src, size_t size) 
+{
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+/* Prints the time per operation for ITERS operations on SIZE
+   bytes, begun at START, as NAME. */
+static void
+report (const char *name, size_t size, int iters, uint64_t start) 
+{
+  uint64_t ns = hrtimer_now () - start;
+
+  msg ("%s, %zu bytes: %"PRIu64" ns.", name, size, ns / iters);
+}
+
+static void
+time_small (size_t size, size_t ofs) 
+{
+  uint64_t start = hrtimer_now ();
+  int i;
+
+  for (i = 0; i < SMALL_ITERS; i++)
+    memcpy (dst + ofs, src + (i & 7), size);
+  report (ofs ? "memcpy unaligned" : "memcpy aligned", size,
+          SMALL_ITERS, start);
+}
+
+void
+test_bench_memcpy (void) 
+{
+  uint64_t start;
+  int i;
+
+  ASSERT (hrtimer_tsc_hz () != 0);
+  src = palloc_get_multiple (PAL_ASSERT, 2);
+  dst = palloc_get_multiple (PAL_ASSERT, 2);
+  for (i = 0; i < PGSIZE; i++)
+    src[i] = i * 7;
+
+  start = hrtimer_now ();
+  for (i = 0; i < PAGE_ITERS; i++)
+    byte_copy (dst, src, PGSIZE);
+  report ("Byte loop", PGSIZE, PAGE_ITERS, start);
+
+  start = hrtimer_now ();
+  for (i = 0; i < PAGE_ITERS; i++)
+    memcpy (dst, src, PGSIZE);
+  report ("memcpy", PGSIZE, PAGE_ITERS, start);
+
+  start = hrtimer_now ();
+  for (i = 0; i < PAGE_ITERS; i++)
+    copy_page (dst, src);
+  report ("copy_page", PGSIZE, PAGE_ITERS, start);
+  if (memcmp (dst, src, PGSIZE))
+    fail ("copy_page produced a different page");
+
+  start = hrtimer_now ();
+  for (i = 0; i < PAGE_ITERS; i++)
+    memmove (dst + 3, dst, PGSIZE);
+  report ("memmove overlapping", PGSIZE, PAGE_ITERS, start);
+
+  start = hrtimer_now ();
+  for (i = 0; i < PAGE_ITERS; i++)
+    memset (dst, i, PGSIZE);
+  report ("memset", PGSIZE, PAGE_ITERS, start);
+
+  start = hrtimer_now ();
+  for (i = 0; i < PAGE_ITERS; i++)
+    clear_page (dst);
+  report ("clear_page", PGSIZE, PAGE_ITERS, start);
+
+  time_small (16, 0);
+  time_small (64, 0);
+  time_small (256, 0);
+  time_small (64, 1);
+  time_small (256, 1);
+
+  palloc_free_multiple (src, 2);
+  palloc_free_multiple (dst, 2);
+}
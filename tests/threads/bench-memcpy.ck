@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+
+check_bench ('Byte loop, 4096 bytes: \d+ ns\.',
+	     'memcpy, 4096 bytes: \d+ ns\.',
+	     'copy_page, 4096 bytes: \d+ ns\.',
+	     'memmove overlapping, 4096 bytes: \d+ ns\.',
+	     'memset, 4096 bytes: \d+ ns\.',
+	     'clear_page, 4096 bytes: \d+ ns\.',
+	     'memcpy aligned, 16 bytes: \d+ ns\.',
+	     'memcpy aligned, 64 bytes: \d+ ns\.',
+	     'memcpy aligned, 256 bytes: \d+ ns\.',
+	     'memcpy unaligned, 64 bytes: \d+ ns\.',
+	     'memcpy unaligned, 256 bytes: \d+ ns\.');
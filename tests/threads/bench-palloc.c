@@ -0,0 +1,58 @@
+/* Measures the page allocator on a fragmented kernel pool.  Takes
+   FRAG_PAGES single pages and frees every other one, leaving that
+   many one-page holes, then times allocating and freeing runs of
+   1, 4 and 16 pages. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "devices/hrtimer.h"
+
+#define FRAG_PAGES 4096
+#define ROUNDS 10000
+
+static void time_runs (size_t cnt);
+
+void
+test_bench_palloc (void) 
+{
+  static void *pages[FRAG_PAGES];
+  int i;
+
+  ASSERT (hrtimer_tsc_hz () != 0);
+
+  for (i = 0; i < FRAG_PAGES; i++) 
+    {
+      pages[i] = palloc_get_page (0);
+      if (pages[i] == NULL)
+        fail ("kernel pool has fewer than %d pages", FRAG_PAGES);
+    }
+  for (i = 0; i < FRAG_PAGES; i += 2)
+    palloc_free_page (pages[i]);
+
+  time_runs (1);
+  time_runs (4);
+  time_runs (16);
+
+  for (i = 1; i < FRAG_PAGES; i += 2)
+    palloc_free_page (pages[i]);
+}
+
+/* Times ROUNDS allocations and frees of CNT pages. */
+static void
+time_runs (size_t cnt) 
+{
+  uint64_t start = hrtimer_now ();
+  int i;
+
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      void *p = palloc_get_multiple (0, cnt);
+      if (p == NULL)
+        fail ("out of pages");
+      palloc_free_multiple (p, cnt);
+    }
+  msg ("%zu-page alloc+free: %"PRIu64" ns.", cnt,
+       (hrtimer_now () - start) / ROUNDS);
+}
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+
+check_bench ('1-page alloc\+free: \d+ ns\.',
+	     '4-page alloc\+free: \d+ ns\.',
+	     '16-page alloc\+free: \d+ ns\.');
@@ -0,0 +1,61 @@
+/* Measures the cost of a voluntary context switch.  The main
+   thread and a helper of the same priority bounce control back
+   and forth through a pair of semaphores, so each round trip is
+   two switches, each made from sema_down(). */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ROUND_TRIPS 100000
+
+static thread_func pong_thread;
+
+void
+test_bench_ping_pong (void) 
+{
+  struct semaphore sema[2];
+  int64_t start_time, ticks;
+  int i;
+
+  /* This test does not work with the MLFQS or CFS. */
+  ASSERT (!thread_mlfqs && !thread_cfs);
+
+  sema_init (&sema[0], 0);
+  sema_init (&sema[1], 0);
+  thread_create ("pong", PRI_DEFAULT, pong_thread, sema);
+
+  /* Start at the beginning of a tick. */
+  timer_sleep (1);
+
+  start_time = timer_ticks ();
+  for (i = 0; i < ROUND_TRIPS; i++) 
+    {
+      sema_up (&sema[0]);
+      sema_down (&sema[1]);
+    }
+  ticks = timer_elapsed (start_time);
+  if (ticks == 0)
+    ticks = 1;
+
+  msg ("%d switches took %"PRId64" ticks.", 2 * ROUND_TRIPS, ticks);
+  msg ("%"PRId64" switches per second.",
+       2 * ROUND_TRIPS * (int64_t) TIMER_FREQ / ticks);
+}
+
+static void
+pong_thread (void *sema_) 
+{
+  struct semaphore *sema = sema_;
+  int i;
+
+  for (i = 0; i < ROUND_TRIPS; i++) 
+    {
+      sema_down (&sema[0]);
+      sema_up (&sema[1]);
+    }
+}
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+
+check_bench ('200000 switches took \d+ ticks\.',
+	     '\d+ switches per second\.');
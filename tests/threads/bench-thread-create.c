@@ -0,0 +1,60 @@
+/* Measures the cost of a thread_create() and thread_exit() round
+   trip.  Each thread is created at a higher priority than the
+   main thread, so it runs and exits before thread_create()
+   returns.
+
+   The round trips are timed twice: first with the thread page
+   cache disabled, so that every thread takes a fresh page from
+   the page allocator as it did before the cache existed, and
+   then with the cache enabled. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ROUND_TRIPS 5000
+
+static int64_t measure (void);
+static void exit_thread (void *aux);
+
+void
+test_bench_thread_create (void) 
+{
+  size_t cache_max = thread_page_cache_max;
+
+  /* This test does not work with the MLFQS or CFS. */
+  ASSERT (!thread_mlfqs && !thread_cfs);
+
+  thread_page_cache_max = 0;
+  msg ("Uncached: %d round trips took %"PRId64" ticks.",
+       ROUND_TRIPS, measure ());
+
+  thread_page_cache_max = cache_max;
+  msg ("Cached: %d round trips took %"PRId64" ticks.",
+       ROUND_TRIPS, measure ());
+}
+
+/* Returns the number of timer ticks taken by ROUND_TRIPS round
+   trips. */
+static int64_t
+measure (void) 
+{
+  int64_t start_time;
+  int i;
+
+  /* Start at the beginning of a tick. */
+  timer_sleep (1);
+
+  start_time = timer_ticks ();
+  for (i = 0; i < ROUND_TRIPS; i++)
+    thread_create ("bench", PRI_DEFAULT + 1, exit_thread, NULL);
+  return timer_elapsed (start_time);
+}
+
+static void
+exit_thread (void *aux UNUSED) 
+{
+}
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+
+check_bench ('Uncached: 5000 round trips took \d+ ticks\.',
+	     'Cached: 5000 round trips took \d+ ticks\.');
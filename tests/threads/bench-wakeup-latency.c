@@ -0,0 +1,128 @@
+/* Measures how long a high-priority thread woken from an interrupt
+   handler waits before it runs, while a lower-priority thread
+   spins in the kernel.  A timer timeout records the time and ups
+   a semaphore that the high-priority thread sleeps on; the thread
+   then reads the time again.
+
+   The spinner first runs with preemption disabled for a time
+   slice at a time, which is how every kernel path behaved before
+   wakeups could preempt at interrupt exit: the woken thread waits
+   for the slice to end.  It then runs preemptibly, and the woken
+   thread should run as soon as the interrupt returns. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/hrtimer.h"
+#include "devices/timer.h"
+
+#define SAMPLES 100
+
+/* Ticks in a time slice; see thread.c. */
+#define SLICE_TICKS 4
+
+static struct semaphore start_sema;     /* Starts a phase. */
+static struct semaphore wake_sema;      /* Upped by the timeout. */
+static struct timeout wake_timeout;
+static volatile uint64_t fired_at;      /* When the timeout fired. */
+static volatile bool phase_done;
+static uint64_t samples[SAMPLES];       /* Latencies in ns. */
+
+static thread_func waker;
+static timeout_func wake_up;
+static void report (const char *name);
+
+void
+test_bench_wakeup_latency (void) 
+{
+  int phase;
+
+  /* This test does not work with the MLFQS or CFS. */
+  ASSERT (!thread_mlfqs && !thread_cfs);
+  ASSERT (hrtimer_tsc_hz () != 0);
+
+  sema_init (&start_sema, 0);
+  sema_init (&wake_sema, 0);
+  timeout_init (&wake_timeout, wake_up, NULL);
+  thread_create ("waker", PRI_DEFAULT + 1, waker, NULL);
+
+  for (phase = 0; phase < 2; phase++) 
+    {
+      phase_done = false;
+      sema_up (&start_sema);
+      while (!phase_done) 
+        {
+          if (phase == 0) 
+            {
+              int64_t start = timer_ticks ();
+              preempt_disable ();
+              while (timer_elapsed (start) < SLICE_TICKS)
+                barrier ();
+              preempt_enable ();
+            }
+          else
+            barrier ();
+        }
+      report (phase == 0 ? "non-preemptible" : "preemptible");
+    }
+}
+
+/* High-priority thread.  Takes SAMPLES samples per phase. */
+static void
+waker (void *aux UNUSED) 
+{
+  int phase, i;
+
+  for (phase = 0; phase < 2; phase++) 
+    {
+      sema_down (&start_sema);
+      for (i = 0; i < SAMPLES; i++) 
+        {
+          timeout_add (&wake_timeout, timer_ticks () + 1);
+          sema_down (&wake_sema);
+          samples[i] = hrtimer_now () - fired_at;
+        }
+      phase_done = true;
+    }
+}
+
+/* Timeout callback. */
+static void
+wake_up (void *aux UNUSED) 
+{
+  fired_at = hrtimer_now ();
+  sema_up (&wake_sema);
+}
+
+/* Prints the distribution of the latencies in samples[]. */
+static void
+report (const char *name) 
+{
+  static const uint64_t bounds[] = {10000, 100000, 1000000, 10000000};
+  int buckets[5] = {0, 0, 0, 0, 0};
+  int i, j;
+
+  /* Insertion sort. */
+  for (i = 1; i < SAMPLES; i++) 
+    {
+      uint64_t s = samples[i];
+      for (j = i; j > 0 && samples[j - 1] > s; j--)
+        samples[j] = samples[j - 1];
+      samples[j] = s;
+    }
+  for (i = 0; i < SAMPLES; i++) 
+    {
+      for (j = 0; j < 4 && samples[i] >= bounds[j]; j++)
+        continue;
+      buckets[j]++;
+    }
+
+  msg ("%s: median %"PRIu64" us, 99th %"PRIu64" us, max %"PRIu64" us.",
+       name, samples[SAMPLES / 2] / 1000, samples[SAMPLES * 99 / 100] / 1000,
+       samples[SAMPLES - 1] / 1000);
+  msg ("%s: <10us %d, <100us %d, <1ms %d, <10ms %d, >=10ms %d.",
+       name, buckets[0], buckets[1], buckets[2], buckets[3], buckets[4]);
+}
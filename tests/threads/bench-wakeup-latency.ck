@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+
+check_bench ('non-preemptible: median \d+ us, 99th \d+ us, max \d+ us\.',
+	     'non-preemptible: <10us \d+, <100us \d+, <1ms \d+, <10ms \d+, >=10ms \d+\.',
+	     'preemptible: median \d+ us, 99th \d+ us, max \d+ us\.',
+	     'preemptible: <10us \d+, <100us \d+, <1ms \d+, <10ms \d+, >=10ms \d+\.');
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# Checks the output of a benchmark.  The run must complete
+# normally, and every regular expression in PATTERNS must match a
+# line that the test printed with msg().  The measured numbers
+# depend on the host, so they are reported but not checked.
+sub check_bench {
+    my (@patterns) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    my ($name) = $test =~ m%([^/]+)$%;
+    for my $pattern (@patterns) {
+	fail "Benchmark printed no line matching \"$pattern\".\n"
+	  if !grep (/^\($name\) $pattern$/, @output);
+    }
+    pass;
+}
+
+1;
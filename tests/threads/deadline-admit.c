@@ -0,0 +1,61 @@
+/* Checks admission control for deadline threads.  Reservations
+   are accepted only while the total stays within 95% of the CPU,
+   a thread may change its own reservation, and a thread that
+   leaves the deadline class or exits gives its share back. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func holder_thread;
+static void try (int64_t runtime, int64_t deadline, int64_t period);
+
+void
+test_deadline_admit (void) 
+{
+  struct semaphore release;
+
+  /* This test does not work with the MLFQS or CFS. */
+  ASSERT (!thread_mlfqs && !thread_cfs);
+
+  /* The holder reserves half the CPU and waits. */
+  sema_init (&release, 0);
+  thread_create ("holder", PRI_DEFAULT + 1, holder_thread, &release);
+
+  try (6, 10, 10);
+  try (4, 10, 10);
+  try (2, 10, 10);
+  try (1, 1, 4);
+  try (3, 2, 10);
+  try (0, 0, 0);
+  try (9, 10, 10);
+
+  /* The holder leaves without giving its share back explicitly. */
+  sema_up (&release);
+  try (9, 10, 10);
+  try (0, 0, 0);
+}
+
+/* Reserves half the CPU, then waits for RELEASE_ and exits. */
+static void
+holder_thread (void *release_) 
+{
+  struct semaphore *release = release_;
+
+  msg ("holder: runtime 5, deadline 10, period 10: %s",
+       thread_set_deadline (5, 10, 10) ? "admitted" : "rejected");
+  sema_down (release);
+  msg ("holder: exiting");
+}
+
+/* Asks for a reservation for this thread and reports the result. */
+static void
+try (int64_t runtime, int64_t deadline, int64_t period) 
+{
+  msg ("runtime %lld, deadline %lld, period %lld: %s",
+       runtime, deadline, period,
+       thread_set_deadline (runtime, deadline, period)
+       ? "admitted" : "rejected");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(deadline-admit) begin
+(deadline-admit) holder: runtime 5, deadline 10, period 10: admitted
+(deadline-admit) runtime 6, deadline 10, period 10: rejected
+(deadline-admit) runtime 4, deadline 10, period 10: admitted
+(deadline-admit) runtime 2, deadline 10, period 10: admitted
+(deadline-admit) runtime 1, deadline 1, period 4: admitted
+(deadline-admit) runtime 3, deadline 2, period 10: rejected
+(deadline-admit) runtime 0, deadline 0, period 0: admitted
+(deadline-admit) runtime 9, deadline 10, period 10: rejected
+(deadline-admit) holder: exiting
+(deadline-admit) runtime 9, deadline 10, period 10: admitted
+(deadline-admit) runtime 0, deadline 0, period 0: admitted
+(deadline-admit) end
+EOF
+pass;
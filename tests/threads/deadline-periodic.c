@@ -0,0 +1,100 @@
+/* Runs a periodic deadline thread against three CPU-bound threads
+   of the highest fixed priority.  Every period, the deadline
+   thread needs one tick of CPU time before its deadline.  Under
+   plain priority scheduling it would get a turn only every few
+   time slices and miss most deadlines; as a deadline thread it
+   should meet every one.  Its priority, PRI_MIN, does not
+   matter. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPINNER_CNT 3
+#define JOB_CNT 20
+
+/* Deadline parameters, in ticks. */
+#define RUNTIME 2
+#define DEADLINE 5
+#define PERIOD 5
+
+static thread_func spinner_thread;
+static thread_func periodic_thread;
+
+static volatile bool done;
+static struct semaphore done_sema;
+static int misses;
+static bool admitted;
+
+void
+test_deadline_periodic (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS or CFS. */
+  ASSERT (!thread_mlfqs && !thread_cfs);
+
+  done = false;
+  sema_init (&done_sema, 0);
+
+  /* Start the background load at our own priority, so that it
+     does not run until we block. */
+  thread_set_priority (PRI_MAX);
+  for (i = 0; i < SPINNER_CNT; i++)
+    thread_create ("spinner", PRI_MAX, spinner_thread, NULL);
+  thread_create ("periodic", PRI_MAX, periodic_thread, NULL);
+  sema_down (&done_sema);
+
+  msg ("Admitted: %s.", admitted ? "yes" : "no");
+  msg ("%d deadline misses in %d periods.", misses, JOB_CNT);
+}
+
+/* Burns CPU until the periodic thread is done. */
+static void
+spinner_thread (void *aux UNUSED) 
+{
+  while (!done)
+    continue;
+}
+
+/* Once admitted, lowers its priority to the minimum and runs
+   JOB_CNT jobs, one per period, each taking one tick of CPU
+   time, counting the jobs that finish after their deadline. */
+static void
+periodic_thread (void *aux UNUSED) 
+{
+  int64_t release;
+  int i;
+
+  admitted = thread_set_deadline (RUNTIME, DEADLINE, PERIOD);
+  thread_set_priority (PRI_MIN);
+
+  release = timer_ticks () + 1;
+  timer_sleep (release - timer_ticks ());
+  for (i = 0; i < JOB_CNT; i++) 
+    {
+      struct rusage usage;
+      int64_t used;
+
+      thread_get_rusage (thread_current (), &usage);
+      used = usage.stime;
+      while (usage.stime == used)
+        thread_get_rusage (thread_current (), &usage);
+
+      if (timer_ticks () > release + DEADLINE)
+        misses++;
+
+      release += PERIOD;
+      if (release > timer_ticks ())
+        timer_sleep (release - timer_ticks ());
+    }
+
+  /* Stop the spinners first: once we leave the deadline class,
+     we will not run again until they are gone. */
+  done = true;
+  thread_set_deadline (0, 0, 0);
+  sema_up (&done_sema);
+}
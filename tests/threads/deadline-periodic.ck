@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(deadline-periodic) begin
+(deadline-periodic) Admitted: yes.
+(deadline-periodic) 0 deadline misses in 20 periods.
+(deadline-periodic) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Starts three threads that each sleep for a different number of
+   microseconds, all well under a timer tick.  They should wake up
+   shortest sleep first, and none before its time is up. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/hrtimer.h"
+#include "devices/timer.h"
+
+static thread_func sleeper;
+
+void
+test_hrtimer_sleep (void) 
+{
+  static int64_t us[] = {3000, 1000, 2000};
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (hrtimer_tsc_hz () != 0);
+
+  for (i = 0; i < 3; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %lld", us[i]);
+      thread_create (name, PRI_DEFAULT + 1, sleeper, &us[i]);
+    }
+  timer_sleep (TIMER_FREQ / 10);
+}
+
+static void
+sleeper (void *us_) 
+{
+  int64_t us = *(int64_t *) us_;
+  uint64_t start = hrtimer_now ();
+  uint64_t elapsed;
+
+  timer_usleep (us);
+  elapsed = hrtimer_now () - start;
+  if (elapsed < (uint64_t) us * 1000)
+    fail ("%s woke up after only %llu ns", thread_name (), elapsed);
+  msg ("%s woke up.", thread_name ());
+}
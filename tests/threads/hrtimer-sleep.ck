@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(hrtimer-sleep) begin
+(hrtimer-sleep) sleeper 1000 woke up.
+(hrtimer-sleep) sleeper 2000 woke up.
+(hrtimer-sleep) sleeper 3000 woke up.
+(hrtimer-sleep) end
+EOF
+pass;
@@ -0,0 +1,107 @@
+/* Allocates and frees runs of 1 to 16 kernel pages in random
+   order, checking that no two live runs overlap and that every run
+   is page-aligned.  Once everything is freed again, the pool must
+   have all its pages back, merged into blocks at least as large as
+   the largest one it had to begin with. */
+
+#include <stdio.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define SLOTS 64
+#define ROUNDS 5000
+#define MAX_RUN 16
+#define MAX_ORDER 10
+
+struct run 
+  {
+    uint64_t *pages;            /* First page, or null. */
+    size_t cnt;                 /* Number of pages. */
+    uint64_t tag;               /* Written at the start of each page. */
+  };
+
+static int largest_block (void);
+static void check_run (const struct run *);
+
+void
+test_palloc_stress (void) 
+{
+  static struct run runs[SLOTS];
+  size_t free_before = palloc_free_cnt (0);
+  int order_before = largest_block ();
+  int i;
+
+  random_init (0);
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      struct run *r = &runs[random_ulong () % SLOTS];
+      size_t p;
+
+      if (r->pages != NULL) 
+        {
+          check_run (r);
+          palloc_free_multiple (r->pages, r->cnt);
+          r->pages = NULL;
+          continue;
+        }
+
+      r->cnt = random_ulong () % MAX_RUN + 1;
+      r->pages = palloc_get_multiple (0, r->cnt);
+      if (r->pages == NULL)
+        continue;
+      if (pg_ofs (r->pages) != 0)
+        fail ("%zu-page run at %p is not page-aligned", r->cnt, r->pages);
+      r->tag = i;
+      for (p = 0; p < r->cnt; p++)
+        r->pages[p * PGSIZE / sizeof *r->pages] = r->tag;
+    }
+
+  for (i = 0; i < SLOTS; i++)
+    if (runs[i].pages != NULL) 
+      {
+        check_run (&runs[i]);
+        palloc_free_multiple (runs[i].pages, runs[i].cnt);
+      }
+  msg ("no runs overlapped");
+
+  if (palloc_free_cnt (0) != free_before)
+    fail ("%zu pages free before, %zu after", free_before, palloc_free_cnt (0));
+  msg ("all pages freed");
+
+  if (largest_block () < order_before)
+    fail ("largest block shrank from order %d to %d",
+          order_before, largest_block ());
+  msg ("free pages merged back");
+}
+
+/* Returns the largest order, up to MAX_ORDER, of a run of 2**order
+   kernel pages that can be allocated right now. */
+static int
+largest_block (void) 
+{
+  int order;
+
+  for (order = MAX_ORDER; order > 0; order--) 
+    {
+      void *pages = palloc_get_multiple (0, 1 << order);
+      if (pages != NULL) 
+        {
+          palloc_free_multiple (pages, 1 << order);
+          break;
+        }
+    }
+  return order;
+}
+
+/* Fails if another run has overwritten any page of R. */
+static void
+check_run (const struct run *r) 
+{
+  size_t p;
+
+  for (p = 0; p < r->cnt; p++)
+    if (r->pages[p * PGSIZE / sizeof *r->pages] != r->tag)
+      fail ("page %zu of run %llu overwritten", p, r->tag);
+}
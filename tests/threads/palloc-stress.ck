@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-stress) begin
+(palloc-stress) no runs overlapped
+(palloc-stress) all pages freed
+(palloc-stress) free pages merged back
+(palloc-stress) end
+EOF
+pass;
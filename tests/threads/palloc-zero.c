@@ -0,0 +1,60 @@
+/* Dirties a few hundred kernel pages, then repeatedly takes a
+   PAL_ZERO page, checks that every byte of it is zero, dirties it
+   and frees it again.  Sleeping now and then lets the background
+   zeroing refill its stack, so both pre-zeroed pages and pages
+   zeroed on demand are checked. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define DIRTY_PAGES 256
+#define ROUNDS 2000
+
+static void check_zero (const uint64_t *page, int round);
+
+void
+test_palloc_zero (void) 
+{
+  static void *pages[DIRTY_PAGES];
+  int i;
+
+  for (i = 0; i < DIRTY_PAGES; i++) 
+    {
+      pages[i] = palloc_get_page (0);
+      if (pages[i] == NULL)
+        fail ("kernel pool has fewer than %d pages", DIRTY_PAGES);
+      memset (pages[i], 0xa5, PGSIZE);
+    }
+  for (i = 0; i < DIRTY_PAGES; i++)
+    palloc_free_page (pages[i]);
+
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      uint64_t *page = palloc_get_page (PAL_ZERO);
+      if (page == NULL)
+        fail ("out of pages");
+      check_zero (page, i);
+      memset (page, 0xa5, PGSIZE);
+      palloc_free_page (page);
+
+      if (i % 100 == 0)
+        timer_sleep (1);
+    }
+  msg ("every PAL_ZERO page was zero");
+}
+
+/* Fails unless PAGE is all zeros. */
+static void
+check_zero (const uint64_t *page, int round) 
+{
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *page; i++)
+    if (page[i] != 0)
+      fail ("round %d: byte %zu of page %p is not zero",
+            round, i * sizeof *page, page);
+}
@@ -0,0 +1,189 @@
+/* Inserts, replaces, finds and deletes random keys in an
+   open-addressing hash table, checking every result against a
+   plain array of which keys are present.  The table starts small
+   and grows many times along the way, so lookups and deletions
+   run against tables that are part way through moving to a
+   larger array. */
+
+#include <random.h>
+#include <stdio.h>
+#include <rhash.h>
+#include "tests/threads/tests.h"
+#include "threads/vaddr.h"
+
+#define KEY_CNT 4096
+#define OP_CNT 100000
+
+struct item 
+  {
+    uint64_t key;               /* Key, a page address. */
+    bool present;               /* In the table? */
+    bool visited;               /* Seen during iteration? */
+    struct rhash_elem elem;
+  };
+
+static struct item items[KEY_CNT];
+static struct item spares[KEY_CNT];
+
+static uint64_t
+item_hash (const struct rhash_elem *e, void *aux UNUSED) 
+{
+  return rhash_int (rhash_entry (e, struct item, elem)->key);
+}
+
+static bool
+item_less (const struct rhash_elem *a, const struct rhash_elem *b,
+           void *aux UNUSED) 
+{
+  return (rhash_entry (a, struct item, elem)->key
+          < rhash_entry (b, struct item, elem)->key);
+}
+
+/* Looks up KEY in H. */
+static struct item *
+lookup (struct rhash *h, uint64_t key) 
+{
+  struct item probe;
+  struct rhash_elem *e;
+
+  probe.key = key;
+  e = rhash_find (h, &probe.elem);
+  return e != NULL ? rhash_entry (e, struct item, elem) : NULL;
+}
+
+/* Checks that iterating H visits every present item once. */
+static void
+check_iteration (struct rhash *h, size_t present) 
+{
+  struct rhash_iterator i;
+  size_t visited = 0;
+  int k;
+
+  for (k = 0; k < KEY_CNT; k++)
+    items[k].visited = spares[k].visited = false;
+
+  rhash_first (&i, h);
+  while (rhash_next (&i)) 
+    {
+      struct item *it = rhash_entry (rhash_cur (&i), struct item, elem);
+      if (!it->present)
+        fail ("iteration found absent key %llu", it->key);
+      if (it->visited)
+        fail ("iteration found key %llu twice", it->key);
+      it->visited = true;
+      visited++;
+    }
+  if (visited != present)
+    fail ("iteration found %zu keys, expected %zu", visited, present);
+}
+
+void
+test_rhash_stress (void) 
+{
+  struct rhash h;
+  size_t present = 0;
+  int op, k;
+
+  random_init (0);
+  if (!rhash_init (&h, item_hash, item_less, NULL))
+    fail ("rhash_init failed");
+
+  for (k = 0; k < KEY_CNT; k++)
+    items[k].key = spares[k].key = (uint64_t) k * PGSIZE;
+
+  for (op = 0; op < OP_CNT; op++) 
+    {
+      k = random_ulong () % KEY_CNT;
+      struct item *it = items[k].present ? &items[k] : &spares[k];
+      struct item *found;
+
+      switch (random_ulong () % 4) 
+        {
+        case 0:
+          /* Insert. */
+          if (!it->present) 
+            {
+              if (rhash_insert (&h, &items[k].elem) != NULL)
+                fail ("insert of absent key %d found a duplicate", k);
+              items[k].present = true;
+              present++;
+            }
+          else if (rhash_insert (&h, &spares[k].elem) != &it->elem)
+            fail ("insert of present key %d did not find it", k);
+          break;
+
+        case 1:
+          /* Replace, swapping the item and its spare. */
+          {
+            struct item *new = it == &items[k] ? &spares[k] : &items[k];
+            struct rhash_elem *old = rhash_replace (&h, &new->elem);
+
+            if (it->present ? old != &it->elem : old != NULL)
+              fail ("replace of key %d returned the wrong item", k);
+            if (!it->present)
+              present++;
+            it->present = false;
+            new->present = true;
+          }
+          break;
+
+        case 2:
+          /* Find. */
+          found = lookup (&h, it->key);
+          if (found != (it->present ? it : NULL))
+            fail ("find of key %d returned the wrong item", k);
+          break;
+
+        case 3:
+          /* Delete. */
+          {
+            struct item probe;
+            struct rhash_elem *old;
+
+            probe.key = it->key;
+            old = rhash_delete (&h, &probe.elem);
+            if (old != (it->present ? &it->elem : NULL))
+              fail ("delete of key %d returned the wrong item", k);
+            if (it->present)
+              present--;
+            it->present = false;
+          }
+          break;
+        }
+
+      if (rhash_size (&h) != present)
+        fail ("table holds %zu keys, expected %zu", rhash_size (&h), present);
+      if (op % 10000 == 0)
+        check_iteration (&h, present);
+    }
+  check_iteration (&h, present);
+  msg ("random operations match");
+
+  /* Fill the table, then empty it again. */
+  for (k = 0; k < KEY_CNT; k++)
+    if (!items[k].present && !spares[k].present) 
+      {
+        rhash_insert (&h, &items[k].elem);
+        items[k].present = true;
+      }
+  if (rhash_size (&h) != KEY_CNT)
+    fail ("full table holds %zu keys", rhash_size (&h));
+  for (k = 0; k < KEY_CNT; k++) 
+    {
+      struct item *it = items[k].present ? &items[k] : &spares[k];
+      if (lookup (&h, it->key) != it)
+        fail ("key %d missing from full table", k);
+    }
+  for (k = KEY_CNT - 1; k >= 0; k--) 
+    {
+      struct item probe;
+      probe.key = items[k].key;
+      if (rhash_delete (&h, &probe.elem) == NULL)
+        fail ("key %d missing while emptying table", k);
+    }
+  if (!rhash_empty (&h))
+    fail ("table not empty after deleting every key");
+  msg ("fill and drain ok");
+
+  rhash_destroy (&h, NULL);
+}
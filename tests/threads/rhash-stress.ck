@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rhash-stress) begin
+(rhash-stress) random operations match
+(rhash-stress) fill and drain ok
+(rhash-stress) end
+EOF
+pass;
@@ -0,0 +1,69 @@
+/* Checks how a reader-writer lock orders its waiters by priority.
+
+   First the main thread holds the lock for reading.  A writer
+   blocks, and so does a reader of lower priority than the writer,
+   but a reader of higher priority than the writer gets in at
+   once.  On release the writer goes before the lower reader.
+
+   Then the main thread holds the lock for writing while a writer
+   and a higher-priority reader block.  On release the reader goes
+   first, since it outranks the writer. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread;
+static thread_func writer_thread;
+
+void
+test_rwlock_priority (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rw_init (&rw);
+
+  rw_read_acquire (&rw);
+  thread_create ("writer 33", PRI_DEFAULT + 2, writer_thread, &rw);
+  thread_create ("reader 32", PRI_DEFAULT + 1, reader_thread, &rw);
+  thread_create ("reader 34", PRI_DEFAULT + 3, reader_thread, &rw);
+  msg ("Releasing read lock.");
+  rw_read_release (&rw);
+
+  rw_write_acquire (&rw);
+  thread_create ("writer 32", PRI_DEFAULT + 1, writer_thread, &rw);
+  thread_create ("reader 33", PRI_DEFAULT + 2, reader_thread, &rw);
+  msg ("Releasing write lock.");
+  rw_write_release (&rw);
+  msg ("This should be the last line before finishing this test.");
+}
+
+static void
+reader_thread (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rw_read_acquire (rw);
+  msg ("%s: got the lock", thread_name ());
+  rw_read_release (rw);
+  msg ("%s: done", thread_name ());
+}
+
+static void
+writer_thread (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rw_write_acquire (rw);
+  msg ("%s: got the lock", thread_name ());
+  rw_write_release (rw);
+  msg ("%s: done", thread_name ());
+}
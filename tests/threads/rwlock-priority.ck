@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-priority) begin
+(rwlock-priority) reader 34: got the lock
+(rwlock-priority) reader 34: done
+(rwlock-priority) Releasing read lock.
+(rwlock-priority) writer 33: got the lock
+(rwlock-priority) writer 33: done
+(rwlock-priority) reader 32: got the lock
+(rwlock-priority) reader 32: done
+(rwlock-priority) Releasing write lock.
+(rwlock-priority) reader 33: got the lock
+(rwlock-priority) reader 33: done
+(rwlock-priority) writer 32: got the lock
+(rwlock-priority) writer 32: done
+(rwlock-priority) This should be the last line before finishing this test.
+(rwlock-priority) end
+EOF
+pass;
@@ -0,0 +1,75 @@
+/* Starts five readers that each hold a reader-writer lock for a
+   while, then a writer.  All five readers should hold the lock at
+   the same time, and the writer should get it only after every
+   reader has let go. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 5
+
+struct rwlock_test 
+  {
+    struct rwlock rw;           /* Lock under test. */
+    struct semaphore done;      /* Upped by each finishing thread. */
+    int holders;                /* Readers holding RW now. */
+    int max_holders;            /* Most readers that held RW at once. */
+  };
+
+static thread_func reader_thread;
+static thread_func writer_thread;
+
+void
+test_rwlock_readers (void) 
+{
+  struct rwlock_test test;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rw_init (&test.rw);
+  sema_init (&test.done, 0);
+  test.holders = test.max_holders = 0;
+
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread, &test);
+    }
+  thread_create ("writer", PRI_DEFAULT, writer_thread, &test);
+
+  for (i = 0; i < READER_CNT + 1; i++)
+    sema_down (&test.done);
+  msg ("Most readers holding the lock at once: %d.", test.max_holders);
+}
+
+static void
+reader_thread (void *test_) 
+{
+  struct rwlock_test *test = test_;
+
+  rw_read_acquire (&test->rw);
+  if (++test->holders > test->max_holders)
+    test->max_holders = test->holders;
+  timer_sleep (10);
+  test->holders--;
+  rw_read_release (&test->rw);
+  sema_up (&test->done);
+}
+
+static void
+writer_thread (void *test_) 
+{
+  struct rwlock_test *test = test_;
+
+  rw_write_acquire (&test->rw);
+  msg ("Writer got the lock with %d readers holding it.", test->holders);
+  rw_write_release (&test->rw);
+  sema_up (&test->done);
+}
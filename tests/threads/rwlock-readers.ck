@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) Writer got the lock with 0 readers holding it.
+(rwlock-readers) Most readers holding the lock at once: 5.
+(rwlock-readers) end
+EOF
+pass;
@@ -0,0 +1,90 @@
+/* Allocates objects from an object cache with a constructor,
+   checking that every object is aligned, constructed, and
+   disjoint from the others, that a freed object comes back in its
+   constructed state without the constructor running again, and
+   that successive slabs start their objects at different
+   offsets into their pages. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+#define OBJ_CNT 100
+#define OBJ_SIZE 300
+#define OBJ_ALIGN 8
+#define CTOR_MAGIC 0x5eed5eed
+
+struct obj 
+  {
+    unsigned magic;             /* Set by the constructor. */
+    int tag;                    /* Set by the test. */
+    char pad[OBJ_SIZE - 2 * sizeof (int)];
+  };
+
+static int ctor_cnt;
+
+static void
+obj_ctor (void *obj_) 
+{
+  struct obj *obj = obj_;
+  obj->magic = CTOR_MAGIC;
+  ctor_cnt++;
+}
+
+void
+test_slab_cache (void) 
+{
+  static struct obj *objs[OBJ_CNT];
+  struct kmem_cache *cache;
+  struct obj *obj;
+  uintptr_t first_ofs = 0;
+  bool colored = false;
+  int ctors;
+  int i;
+
+  cache = kmem_cache_create ("test", sizeof (struct obj), OBJ_ALIGN,
+                             obj_ctor);
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      obj = objs[i] = kmem_cache_alloc (cache);
+      if (obj == NULL)
+        fail ("allocation %d failed", i);
+      if ((uintptr_t) obj % OBJ_ALIGN != 0)
+        fail ("object %d at %p is misaligned", i, obj);
+      if (obj->magic != CTOR_MAGIC)
+        fail ("object %d was not constructed", i);
+      obj->tag = i;
+
+      /* Objects are handed out in address order within a fresh
+         slab, so the first one in each page is its slab's first. */
+      if (i == 0 || pg_round_down (obj) != pg_round_down (objs[i - 1])) 
+        {
+          if (i > 0 && pg_ofs (obj) != first_ofs)
+            colored = true;
+          first_ofs = pg_ofs (obj);
+        }
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    if (objs[i]->tag != i)
+      fail ("object %d overwritten", i);
+  msg ("objects aligned and disjoint");
+
+  ctors = ctor_cnt;
+  obj = objs[OBJ_CNT / 2];
+  kmem_cache_free (cache, obj);
+  objs[OBJ_CNT / 2] = kmem_cache_alloc (cache);
+  if (objs[OBJ_CNT / 2] != obj)
+    fail ("freed object %p not reused, got %p", obj, objs[OBJ_CNT / 2]);
+  if (obj->magic != CTOR_MAGIC || ctor_cnt != ctors)
+    fail ("reused object was constructed again");
+  msg ("constructor ran once per object");
+
+  if (!colored)
+    fail ("every slab starts at page offset %zu", (size_t) first_ofs);
+  msg ("slabs are colored");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+  kmem_cache_shrink (cache);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-cache) begin
+(slab-cache) objects aligned and disjoint
+(slab-cache) constructor ran once per object
+(slab-cache) slabs are colored
+(slab-cache) end
+EOF
+pass;
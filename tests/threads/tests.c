@@ -29,6 +29,25 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"rwlock-readers", test_rwlock_readers},
+    {"rwlock-priority", test_rwlock_priority},
+    {"wait-queue", test_wait_queue},
+    {"workqueue", test_workqueue},
+    {"hrtimer-sleep", test_hrtimer_sleep},
+    {"deadline-admit", test_deadline_admit},
+    {"deadline-periodic", test_deadline_periodic},
+    {"palloc-stress", test_palloc_stress},
+    {"palloc-zero", test_palloc_zero},
+    {"slab-cache", test_slab_cache},
+    {"rhash-stress", test_rhash_stress},
+    {"bench-thread-create", test_bench_thread_create},
+    {"bench-ping-pong", test_bench_ping_pong},
+    {"bench-wakeup-latency", test_bench_wakeup_latency},
+    {"bench-palloc", test_bench_palloc},
+    {"bench-malloc", test_bench_malloc},
+    {"bench-bitmap", test_bench_bitmap},
+    {"bench-memcpy", test_bench_memcpy},
+    {"bench-direct-map", test_bench_direct_map},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +57,9 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"cfs-fair-2", test_cfs_fair_2},
+    {"cfs-nice-2", test_cfs_nice_2},
+    {"cfs-nice-10", test_cfs_nice_10},
   };
 
 static const char *test_name;
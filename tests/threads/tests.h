@@ -23,6 +23,25 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_rwlock_readers;
+extern test_func test_rwlock_priority;
+extern test_func test_wait_queue;
+extern test_func test_workqueue;
+extern test_func test_hrtimer_sleep;
+extern test_func test_deadline_admit;
+extern test_func test_deadline_periodic;
+extern test_func test_palloc_stress;
+extern test_func test_palloc_zero;
+extern test_func test_slab_cache;
+extern test_func test_rhash_stress;
+extern test_func test_bench_thread_create;
+extern test_func test_bench_ping_pong;
+extern test_func test_bench_wakeup_latency;
+extern test_func test_bench_palloc;
+extern test_func test_bench_malloc;
+extern test_func test_bench_bitmap;
+extern test_func test_bench_memcpy;
+extern test_func test_bench_direct_map;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +51,9 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_nice_2;
+extern test_func test_cfs_nice_10;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,56 @@
+/* Puts two non-exclusive and three exclusive waiters of assorted
+   priorities to sleep on a wait queue, then wakes it with room
+   for one exclusive waiter at a time.  The first wakeup should
+   rouse both non-exclusive waiters and the highest-priority
+   exclusive one; each later wakeup, the next exclusive waiter. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func shared_thread;
+static thread_func exclusive_thread;
+
+void
+test_wait_queue (void) 
+{
+  struct wait_queue wq;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  wait_queue_init (&wq);
+  thread_create ("shared 32", PRI_DEFAULT + 1, shared_thread, &wq);
+  thread_create ("exclusive 33", PRI_DEFAULT + 2, exclusive_thread, &wq);
+  thread_create ("exclusive 34", PRI_DEFAULT + 3, exclusive_thread, &wq);
+  thread_create ("shared 35", PRI_DEFAULT + 4, shared_thread, &wq);
+  thread_create ("exclusive 36", PRI_DEFAULT + 5, exclusive_thread, &wq);
+
+  for (i = 0; i < 4; i++) 
+    {
+      msg ("Woke %d threads.", wait_queue_wake (&wq, 1));
+      thread_yield ();
+    }
+}
+
+static void
+shared_thread (void *wq) 
+{
+  enum intr_level old_level = intr_disable ();
+  wait_queue_sleep (wq, false);
+  intr_set_level (old_level);
+  msg ("%s woke up.", thread_name ());
+}
+
+static void
+exclusive_thread (void *wq) 
+{
+  enum intr_level old_level = intr_disable ();
+  wait_queue_sleep (wq, true);
+  intr_set_level (old_level);
+  msg ("%s woke up.", thread_name ());
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(wait-queue) begin
+(wait-queue) Woke 3 threads.
+(wait-queue) exclusive 36 woke up.
+(wait-queue) shared 35 woke up.
+(wait-queue) shared 32 woke up.
+(wait-queue) Woke 1 threads.
+(wait-queue) exclusive 34 woke up.
+(wait-queue) Woke 1 threads.
+(wait-queue) exclusive 33 woke up.
+(wait-queue) Woke 0 threads.
+(wait-queue) end
+EOF
+pass;
@@ -0,0 +1,81 @@
+/* Queues work items of assorted priorities on a work queue whose
+   worker runs below the main thread, so that none runs until the
+   main thread flushes the queue.  They should then run highest
+   priority first, FIFO among equal priorities, skipping the one
+   that was cancelled.  Then checks that delayed work runs after
+   its delay, at once when flushed, and not at all when
+   cancelled. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+struct test_work 
+  {
+    struct work work;
+    const char *name;
+  };
+
+static work_func test_work_func;
+
+static void
+test_work_init (struct test_work *tw, const char *name, int priority) 
+{
+  tw->name = name;
+  work_init (&tw->work, test_work_func, priority);
+}
+
+void
+test_workqueue (void) 
+{
+  struct workqueue *wq;
+  struct test_work a, b, c, d, e;
+  struct delayed_work dw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  wq = workqueue_create ("test-wq", 1, PRI_DEFAULT - 1);
+  ASSERT (wq != NULL);
+
+  test_work_init (&a, "a", 10);
+  test_work_init (&b, "b", 20);
+  test_work_init (&c, "c", 20);
+  test_work_init (&d, "d", 5);
+  test_work_init (&e, "e", 15);
+  queue_work (wq, &a.work);
+  queue_work (wq, &b.work);
+  queue_work (wq, &c.work);
+  queue_work (wq, &d.work);
+  queue_work (wq, &e.work);
+  msg ("Queueing b again: %d.", queue_work (wq, &b.work));
+  msg ("Cancelling d: %d.", cancel_work (&d.work));
+  flush_workqueue (wq);
+  msg ("Flushed the queue.");
+
+  delayed_work_init (&dw, test_work_func, 0);
+  queue_delayed_work (wq, &dw, 5);
+  timer_sleep (20);
+  msg ("Slept past the delay.");
+
+  queue_delayed_work (wq, &dw, 1000);
+  flush_delayed_work (&dw);
+  msg ("Flushed the delayed work.");
+
+  queue_delayed_work (wq, &dw, 5);
+  msg ("Cancelling the delayed work: %d.", cancel_delayed_work (&dw));
+  timer_sleep (20);
+  msg ("Slept past the delay.");
+}
+
+static void
+test_work_func (struct work *w) 
+{
+  if (w->priority == 0)
+    msg ("Ran the delayed work.");
+  else
+    msg ("Ran %s.", work_entry (w, struct test_work, work)->name);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Queueing b again: 0.
+(workqueue) Cancelling d: 1.
+(workqueue) Ran b.
+(workqueue) Ran c.
+(workqueue) Ran e.
+(workqueue) Ran a.
+(workqueue) Flushed the queue.
+(workqueue) Ran the delayed work.
+(workqueue) Slept past the delay.
+(workqueue) Ran the delayed work.
+(workqueue) Flushed the delayed work.
+(workqueue) Cancelling the delayed work: 1.
+(workqueue) Slept past the delay.
+(workqueue) end
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Checks clock_gettime(): CLOCK_MONOTONIC never goes back, its
+   nanoseconds stay in range, and it advances in steps much finer
+   than a timer tick.  An unknown clock is rejected. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Nanoseconds in one 100 Hz timer tick. */
+#define TICK_NS 10000000
+
+static int64_t
+ns (const struct timespec *ts) 
+{
+  return ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+void
+test_main (void) 
+{
+  struct timespec prev, now;
+  int64_t step = TICK_NS;
+  int i;
+
+  CHECK (clock_gettime (CLOCK_MONOTONIC, &prev) == 0,
+         "clock_gettime (CLOCK_MONOTONIC)");
+  for (i = 0; i < 1000; i++) 
+    {
+      clock_gettime (CLOCK_MONOTONIC, &now);
+      if (now.tv_nsec < 0 || now.tv_nsec >= 1000000000)
+        fail ("tv_nsec out of range: %lld", now.tv_nsec);
+      if (ns (&now) < ns (&prev))
+        fail ("clock went back from %lld to %lld ns", ns (&prev), ns (&now));
+      if (ns (&now) > ns (&prev) && ns (&now) - ns (&prev) < step)
+        step = ns (&now) - ns (&prev);
+      prev = now;
+    }
+  if (step >= TICK_NS)
+    fail ("clock only advanced in whole ticks");
+  msg ("clock advances in less than a tick");
+  CHECK (clock_gettime (12345, &now) == -1,
+         "clock_gettime (12345) must fail");
+}
@@ -0,0 +1,24 @@
+/* Checks getrusage(): a process that spins is eventually charged
+   user time, and a pid that is neither the caller nor one of its
+   children is rejected. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage ru;
+  volatile int i;
+
+  CHECK (getrusage (0, &ru) == 0, "getrusage (0)");
+  while (ru.utime == 0) 
+    {
+      for (i = 0; i < 100000; i++)
+        continue;
+      getrusage (0, &ru);
+    }
+  msg ("charged user time");
+  CHECK (getrusage (12345, &ru) == -1, "getrusage (12345) must fail");
+}
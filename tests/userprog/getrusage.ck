@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getrusage) begin
+(getrusage) getrusage (0)
+(getrusage) charged user time
+(getrusage) getrusage (12345) must fail
+(getrusage) end
+getrusage: exit(0)
+EOF
+pass;
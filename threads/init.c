@@ -8,6 +8,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "intrinsic.h"
+#include "devices/hrtimer.h"
 #include "devices/kbd.h"
 #include "devices/input.h"
 #include "devices/serial.h"
@@ -20,7 +22,11 @@
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/vaddr.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -41,6 +47,10 @@
 /* Page-map-level-4 with kernel mappings only. */
 uint64_t *base_pml4;
 
+/* Number of 4 kB, 2 MB and 1 GB pages in the kernel's mapping of
+   physical memory. */
+static size_t direct_map_cnt[3];
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -53,6 +63,9 @@ bool thread_tests;
 
 static void bss_init (void);
 static void paging_init (uint64_t mem_end);
+static bool large_page_fits (uint64_t pa, uint64_t va, uint64_t size,
+		uint64_t mem_end, uint64_t text_start, uint64_t text_end);
+static bool cpu_has_gbpages (void);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
@@ -85,6 +98,7 @@ main (void) {
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	slab_init ();
 	paging_init (mem_end);
 
 #ifdef USERPROG
@@ -105,6 +119,9 @@ main (void) {
 	thread_start ();
 	serial_init_queue ();
 	timer_calibrate ();
+	hrtimer_calibrate ();
+	if (smp_enabled)
+		smp_init ();
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -150,23 +167,66 @@ paging_init (uint64_t mem_end) {
 	pml4 = base_pml4 = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 
 	extern char start, _end_kernel_text;
+	uint64_t text_start = vtop (&start), text_end = vtop (&_end_kernel_text);
+	bool gbpages = cpu_has_gbpages ();
+
 	// Maps physical address [0 ~ mem_end] to
-	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end],
+	//   with the largest pages that fit.  Kernel text must be
+	//   read-only, so the 2 MB around it is mapped with 4 kB pages.
+	for (uint64_t pa = 0; pa < mem_end; ) {
 		uint64_t va = (uint64_t) ptov(pa);
+		uint64_t size = 0;
+
+		if (gbpages && large_page_fits (pa, va, PDPE_LARGE_SIZE, mem_end,
+					text_start, text_end))
+			size = PDPE_LARGE_SIZE;
+		else if (large_page_fits (pa, va, PDE_LARGE_SIZE, mem_end,
+					text_start, text_end))
+			size = PDE_LARGE_SIZE;
+
+		if (size != 0) {
+			if (!pml4_map_large (pml4, va, pa, size, PTE_W))
+				PANIC ("paging_init: out of memory");
+			direct_map_cnt[size == PDE_LARGE_SIZE ? 1 : 2]++;
+			pa += size;
+			continue;
+		}
 
 		perm = PTE_P | PTE_W;
-		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
+		if (text_start <= pa && pa < text_end)
 			perm &= ~PTE_W;
 
 		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
 			*pte = pa | perm;
+		direct_map_cnt[0]++;
+		pa += PGSIZE;
 	}
 
 	// reload cr3
 	pml4_activate(0);
 }
 
+/* Returns true if physical address PA can be mapped at virtual
+   address VA with a large page of SIZE bytes: both must be
+   aligned to SIZE, and the page must end by MEM_END and not
+   overlap kernel text at [TEXT_START, TEXT_END). */
+static bool
+large_page_fits (uint64_t pa, uint64_t va, uint64_t size, uint64_t mem_end,
+		uint64_t text_start, uint64_t text_end) {
+	return (pa % size == 0 && va % size == 0 && pa + size <= mem_end
+			&& (pa + size <= text_start || pa >= text_end));
+}
+
+/* Returns true if the CPU supports 1 GB pages. */
+static bool
+cpu_has_gbpages (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (0x80000001, &eax, &ebx, &ecx, &edx);
+	return (edx & (1u << 26)) != 0;
+}
+
 /* Breaks the kernel command line into words and returns them as
    an argv-like array. */
 static char **
@@ -221,6 +281,14 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-cfs"))
+			thread_cfs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-smp"))
+			smp_enabled = true;
+		else if (!strcmp (name, "-trace"))
+			trace_enabled = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -231,6 +299,9 @@ parse_options (char **argv) {
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
 
+	if (thread_mlfqs && thread_cfs)
+		PANIC ("-mlfqs and -cfs are mutually exclusive");
+
 	return argv;
 }
 
@@ -326,6 +397,11 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -cfs               Use completely fair scheduler.\n"
+			"  -tickless          Stop the periodic timer tick while idle.\n"
+			"  -smp               Boot the other processors found in ACPI and park\n"
+			"                     them; threads still run on the first one only.\n"
+			"  -trace             Record scheduler events; dump them at power off.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -342,6 +418,8 @@ power_off (void) {
 	filesys_done ();
 #endif
 
+	if (trace_enabled)
+		trace_dump ();
 	print_stats ();
 
 	printf ("Powering off...\n");
@@ -354,6 +432,10 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	printf ("Direct map: %zu 4 kB pages, %zu 2 MB pages, %zu 1 GB pages\n",
+			direct_map_cnt[0], direct_map_cnt[1], direct_map_cnt[2]);
+	palloc_print_stats ();
+	slab_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -203,6 +203,13 @@ intr_init (void) {
 	intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Loads the IDT built by intr_init() on an application
+   processor.  See threads/smp.c. */
+void
+intr_init_ap (void) {
+	lidt(&idt_desc);
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -370,7 +377,7 @@ intr_handler (struct intr_frame *frame) {
 		pic_end_of_interrupt (frame->vec_no);
 
 		if (yield_on_return)
-			thread_yield ();
+			preempt_schedule_irq ();
 	}
 }
 
@@ -7,38 +7,54 @@
 #include <string.h>
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
+   The size of each request, in bytes, is rounded up to the next
+   size class and assigned to the "descriptor" that manages blocks
+   of that size.  The size classes are the powers of 2 from 16
+   bytes up, with one more halfway between each pair, so that no
+   more than a third of a block is wasted.
+
+   Each thread keeps a small cache of free blocks of each size, a
+   struct malloc_cache that only it touches and so needs no lock.
+   The cache itself is a block, allocated the first time the
+   thread calls malloc() or free(), so that struct thread only
+   holds a pointer to it.  malloc() takes a block from there, and
+   free() puts one back.  When a thread's cache is empty, it is
+   refilled with a batch of blocks from the descriptor's free list
+   in one go, under the descriptor's lock; when it is full, a batch
+   goes back the same way.  thread_exit() gives back whatever is
+   left.
+
+   If the descriptor's free list is empty too, blocks are carved
+   out of its newest page of memory, called an "arena", one at a
+   time.  Once that is used up, a new arena is obtained from the
+   page allocator (if none is available, malloc() returns a null
+   pointer).
+
+   When a block returns to its descriptor, it goes on the free
+   list.  But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
+   We can't handle blocks bigger than 1.5 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.  realloc()
+   resizes such a block in place when it can, by giving back pages
+   at its end or claiming the free pages that follow it. */
 
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
+	size_t cache_max;           /* Blocks per thread cache. */
 	struct list free_list;      /* List of free blocks. */
+	struct arena *carve;        /* Arena with blocks never used, or null. */
 	struct lock lock;           /* Lock. */
 };
 
@@ -50,19 +66,45 @@ struct arena {
 	unsigned magic;             /* Always set to ARENA_MAGIC. */
 	struct desc *desc;          /* Owning descriptor, null for big block. */
 	size_t free_cnt;            /* Free blocks; pages in big block. */
+	size_t carved;              /* Blocks ever handed out. */
 };
 
 /* Free block. */
 struct block {
-	struct list_elem free_elem; /* Free list element. */
+	union {
+		struct list_elem free_elem; /* Free list element. */
+		struct block *next;     /* Next block in a thread cache. */
+	};
 };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[MALLOC_CLASSES]; /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static size_t size_class (size_t size);
+static struct block *desc_get (struct desc *);
+static void desc_put (struct desc *, struct block *);
+static struct malloc_cache *cache_get (void);
+static bool cache_refill (struct malloc_cache *, size_t class);
+static void cache_drain (struct malloc_cache *, size_t class, size_t cnt);
+
+/* Adds a descriptor for blocks of BLOCK_SIZE bytes. */
+static void
+add_desc (size_t block_size) {
+	struct desc *d = &descs[desc_cnt++];
+
+	ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+	d->block_size = block_size;
+	d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+	d->cache_max = 8 * PGSIZE / block_size;
+	if (d->cache_max > 32)
+		d->cache_max = 32;
+	list_init (&d->free_list);
+	d->carve = NULL;
+	lock_init (&d->lock);
+}
 
 /* Initializes the malloc() descriptors. */
 void
@@ -70,22 +112,20 @@ malloc_init (void) {
 	size_t block_size;
 
 	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
-		struct desc *d = &descs[desc_cnt++];
-		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-		d->block_size = block_size;
-		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-		list_init (&d->free_list);
-		lock_init (&d->lock);
+		add_desc (block_size);
+		add_desc (block_size / 2 * 3);
 	}
+	ASSERT (desc_cnt == MALLOC_CLASSES);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) {
-	struct desc *d;
+	struct malloc_cache *mc;
 	struct block *b;
 	struct arena *a;
+	size_t class;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
@@ -93,10 +133,8 @@ malloc (size_t size) {
 
 	/* Find the smallest descriptor that satisfies a SIZE-byte
 	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	class = size_class (size);
+	if (class >= desc_cnt) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
@@ -112,34 +150,14 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
-
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
-
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
-			return NULL;
-		}
-
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
-		}
-	}
-
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
-	lock_release (&d->lock);
+	/* Take a block from this thread's cache, refilling it from the
+	   descriptor if it is empty. */
+	mc = cache_get ();
+	if (mc == NULL || (mc->cnt[class] == 0 && !cache_refill (mc, class)))
+		return NULL;
+	b = mc->blocks[class];
+	mc->blocks[class] = b->next;
+	mc->cnt[class]--;
 	return b;
 }
 
@@ -173,6 +191,26 @@ block_size (void *block) {
 	return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
 }
 
+/* Tries to resize the big block OLD_BLOCK, whose arena is A, to
+   NEW_SIZE bytes without moving it.  Returns true if successful,
+   false if the pages that follow it are in use. */
+static bool
+resize_in_place (struct arena *a, size_t new_size) {
+	size_t page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+
+	if (page_cnt <= a->free_cnt) {
+		/* Shrink, giving back the pages we no longer need. */
+		palloc_free_multiple ((uint8_t *) a + page_cnt * PGSIZE,
+				a->free_cnt - page_cnt);
+		a->free_cnt = page_cnt;
+		return true;
+	} else if (palloc_grow (a, a->free_cnt, page_cnt)) {
+		a->free_cnt = page_cnt;
+		return true;
+	} else
+		return false;
+}
+
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
    moving it in the process.
    If successful, returns the new block; on failure, returns a
@@ -184,9 +222,21 @@ realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
 		free (old_block);
 		return NULL;
-	} else {
-		void *new_block = malloc (new_size);
-		if (old_block != NULL && new_block != NULL) {
+	} else if (old_block == NULL)
+		return malloc (new_size);
+	else {
+		struct arena *a = block_to_arena (old_block);
+		size_t class = size_class (new_size);
+		void *new_block;
+
+		/* Keep the block where it is if NEW_SIZE is in the same size
+		   class, or if it is big and stays big. */
+		if (a->desc != NULL ? class == (size_t) (a->desc - descs)
+				: class >= desc_cnt && resize_in_place (a, new_size))
+			return old_block;
+
+		new_block = malloc (new_size);
+		if (new_block != NULL) {
 			size_t old_size = block_size (old_block);
 			size_t min_size = new_size < old_size ? new_size : old_size;
 			memcpy (new_block, old_block, min_size);
@@ -206,31 +256,29 @@ free (void *p) {
 		struct desc *d = a->desc;
 
 		if (d != NULL) {
-			/* It's a normal block.  We handle it here. */
+			/* It's a normal block.  Put it in this thread's cache,
+			   first making room if the cache is full. */
+			struct malloc_cache *mc = cache_get ();
+			size_t class = d - descs;
 
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+			if (mc == NULL) {
+				/* No cache: give the block straight back. */
+				lock_acquire (&d->lock);
+				desc_put (d, b);
+				lock_release (&d->lock);
+				return;
 			}
 
-			lock_release (&d->lock);
+			if (mc->cnt[class] >= d->cache_max)
+				cache_drain (mc, class, d->cache_max / 2);
+			b->next = mc->blocks[class];
+			mc->blocks[class] = b;
+			mc->cnt[class]++;
 		} else {
 			/* It's a big block.  Free its pages. */
 			palloc_free_multiple (a, a->free_cnt);
@@ -238,7 +286,162 @@ free (void *p) {
 		}
 	}
 }
-
+
+/* Returns every block in the running thread's cache to its
+   descriptor, then frees the cache itself.  Called when the
+   thread exits. */
+void
+malloc_cache_flush (void) {
+	struct thread *t = thread_current ();
+	struct malloc_cache *mc = t->malloc_cache;
+	struct desc *d;
+	size_t class;
+
+	if (mc == NULL)
+		return;
+	for (class = 0; class < desc_cnt; class++)
+		if (mc->cnt[class] > 0)
+			cache_drain (mc, class, mc->cnt[class]);
+
+	t->malloc_cache = NULL;
+	d = &descs[size_class (sizeof *mc)];
+	lock_acquire (&d->lock);
+	desc_put (d, (struct block *) mc);
+	lock_release (&d->lock);
+}
+
+/* Returns the index of the smallest descriptor whose blocks hold
+   SIZE bytes, or a value of at least desc_cnt if there is none.
+   Descriptor 2*K holds 16 << K bytes and descriptor 2*K + 1
+   holds 24 << K bytes. */
+static size_t
+size_class (size_t size) {
+	int order;
+
+	if (size <= 16)
+		return 0;
+
+	/* 2**ORDER < SIZE <= 2**(ORDER + 1). */
+	order = 63 - __builtin_clzll (size - 1);
+	return 2 * (order - 4) + (size > (size_t) 3 << (order - 1) ? 2 : 1);
+}
+
+/* Takes a free block from descriptor D, whose lock must be held.
+   Returns a null pointer if memory is not available. */
+static struct block *
+desc_get (struct desc *d) {
+	struct block *b;
+	struct arena *a;
+
+	if (!list_empty (&d->free_list)) {
+		b = list_entry (list_pop_front (&d->free_list), struct block,
+				free_elem);
+		a = block_to_arena (b);
+	} else {
+		/* Carve the next unused block out of the newest arena,
+		   allocating one if need be. */
+		if (d->carve == NULL) {
+			a = palloc_get_page (0);
+			if (a == NULL)
+				return NULL;
+			a->magic = ARENA_MAGIC;
+			a->desc = d;
+			a->free_cnt = d->blocks_per_arena;
+			a->carved = 0;
+			d->carve = a;
+		}
+		a = d->carve;
+		b = arena_to_block (a, a->carved++);
+		if (a->carved == d->blocks_per_arena)
+			d->carve = NULL;
+	}
+	a->free_cnt--;
+	return b;
+}
+
+/* Returns block B to descriptor D, whose lock must be held. */
+static void
+desc_put (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	list_push_front (&d->free_list, &b->free_elem);
+
+	/* If the arena is now entirely unused, free it, unless we are
+	   still carving it. */
+	if (++a->free_cnt >= d->blocks_per_arena && a != d->carve) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		for (i = 0; i < a->carved; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+		palloc_free_page (a);
+	}
+}
+
+/* Returns the running thread's cache, allocating it straight
+   from its descriptor on first use.  Returns a null pointer if
+   memory is not available. */
+static struct malloc_cache *
+cache_get (void) {
+	struct thread *t = thread_current ();
+
+	if (t->malloc_cache == NULL) {
+		struct desc *d = &descs[size_class (sizeof *t->malloc_cache)];
+		struct malloc_cache *mc;
+
+		lock_acquire (&d->lock);
+		mc = (struct malloc_cache *) desc_get (d);
+		lock_release (&d->lock);
+		if (mc == NULL)
+			return NULL;
+		memset (mc, 0, sizeof *mc);
+		t->malloc_cache = mc;
+	}
+	return t->malloc_cache;
+}
+
+/* Refills empty cache MC of size class CLASS with half its
+   capacity of blocks.  Returns false if not even one block could
+   be obtained. */
+static bool
+cache_refill (struct malloc_cache *mc, size_t class) {
+	struct desc *d = &descs[class];
+	size_t cnt;
+
+	lock_acquire (&d->lock);
+	for (cnt = 0; cnt < d->cache_max / 2; cnt++) {
+		struct block *b = desc_get (d);
+		if (b == NULL)
+			break;
+		b->next = mc->blocks[class];
+		mc->blocks[class] = b;
+	}
+	lock_release (&d->lock);
+
+	mc->cnt[class] = cnt;
+	return cnt > 0;
+}
+
+/* Returns CNT blocks from cache MC of size class CLASS to their
+   descriptor. */
+static void
+cache_drain (struct malloc_cache *mc, size_t class, size_t cnt) {
+	struct desc *d = &descs[class];
+
+	ASSERT (cnt <= mc->cnt[class]);
+
+	lock_acquire (&d->lock);
+	mc->cnt[class] -= cnt;
+	while (cnt-- > 0) {
+		struct block *b = mc->blocks[class];
+		mc->blocks[class] = b->next;
+		desc_put (d, b);
+	}
+	lock_release (&d->lock);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
@@ -23,6 +23,8 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
+		if (pdp[idx] & PTE_PS)
+			return &pdp[idx];
 		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
 	}
 	return NULL;
@@ -46,6 +48,8 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
+		if (pdpe[idx] & PTE_PS)
+			return &pdpe[idx];
 		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
@@ -60,7 +64,9 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
  * If PML4E does not have a page table for VADDR, behavior depends
  * on CREATE.  If CREATE is true, then a new page table is
  * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. */
+ * pointer is returned.
+ * If VADDR lies in a large page, returns the PDE or PDPE that
+ * maps it, which has PTE_PS set, instead. */
 uint64_t *
 pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	uint64_t *pte = NULL;
@@ -88,6 +94,39 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Maps the large page of SIZE bytes, PDE_LARGE_SIZE or
+ * PDPE_LARGE_SIZE, at virtual address VA in PML4 to physical
+ * address PA with FLAGS, creating the tables above it as needed.
+ * VA and PA must be aligned to SIZE, and VA must not be mapped
+ * yet.  Returns true if successful, false if memory allocation
+ * failed. */
+bool
+pml4_map_large (uint64_t *pml4, uint64_t va, uint64_t pa, uint64_t size,
+		uint64_t flags) {
+	uint64_t *table;
+	uint64_t *entry = &pml4[PML4 (va)];
+	int idx[] = { PDPE (va), PDX (va) };
+	int levels = size == PDE_LARGE_SIZE ? 2 : 1;
+
+	ASSERT (size == PDE_LARGE_SIZE || size == PDPE_LARGE_SIZE);
+	ASSERT (va % size == 0 && pa % size == 0);
+
+	for (int i = 0; i < levels; i++) {
+		if (!(*entry & PTE_P)) {
+			uint64_t *new_page = palloc_get_page (PAL_ZERO);
+			if (new_page == NULL)
+				return false;
+			*entry = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		ASSERT (!(*entry & PTE_PS));
+		table = ptov (PTE_ADDR (*entry));
+		entry = &table[idx[i]];
+	}
+	ASSERT (!(*entry & PTE_P));
+	*entry = pa | flags | PTE_PS | PTE_P;
+	return true;
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -96,7 +135,7 @@ uint64_t *
 pml4_create (void) {
 	uint64_t *pml4 = palloc_get_page (0);
 	if (pml4)
-		memcpy (pml4, base_pml4, PGSIZE);
+		copy_page (pml4, base_pml4);
 	return pml4;
 }
 
@@ -122,7 +161,13 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if ((pdp[i] & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS)) {
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -135,7 +180,12 @@ pdp_for_each (uint64_t *pdp,
 		pte_for_each_func *func, void *aux, unsigned pml4_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pde) & PTE_P)
+		if ((pdp[i] & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS)) {
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) i << PDPESHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pde) & PTE_P)
 			if (!pgdir_for_each ((uint64_t *) PTE_ADDR (pde), func,
 					 aux, pml4_index, i))
 				return false;
@@ -143,7 +193,9 @@ pdp_for_each (uint64_t *pdp,
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * A large page is visited once, through its PDE or PDPE, which has
+ * PTE_PS set. */
 bool
 pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
@@ -169,7 +221,7 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if ((((uint64_t) pte) & PTE_P) && !(pdp[i] & PTE_PS))
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -179,7 +231,7 @@ static void
 pdpe_destroy (uint64_t *pdpe) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdpe[i]);
-		if (((uint64_t) pde) & PTE_P)
+		if ((((uint64_t) pde) & PTE_P) && !(pdpe[i] & PTE_PS))
 			pgdir_destroy ((void *) PTE_ADDR (pde));
 	}
 	palloc_free_page ((void *) pdpe);
@@ -1,6 +1,6 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
+#include <list.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stddef.h>
@@ -8,8 +8,10 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,13 +26,84 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a buddy allocator.  Its free pages are kept as
+   blocks of 2**ORDER pages, aligned to their size relative to the
+   pool's base, on one free list per order.  An allocation takes
+   the smallest block that fits, splitting larger ones in halves as
+   needed, and gives back the pages it does not need.  A freed
+   block is merged with its buddy, the other half of the block
+   twice its size, for as long as the buddy is free too.  So both
+   take O(lg n) time, whatever the state of the pool.
+
+   Besides a list element, the pool keeps one byte of state per
+   page: the order of the free block that the page begins, or
+   PAGE_USED for every other page.  Both live outside the pool, so
+   that free pages are never written to: not all of them are
+   mapped yet when palloc_init() runs.
+
+   Single pages, by far the most common request, are served from a
+   magazine in front of each pool: a stack of up to MAG_SIZE free
+   pages that is used with interrupts off instead of the pool
+   lock.  An empty magazine is refilled, and a full one
+   drained, MAG_BATCH pages at a time under the lock.  Pages left
+   in a magazine are still counted as free, and are drained back to
+   the pool if a multi-page request would fail for lack of them.
+
+   Each pool also keeps a stack of up to ZERO_MAX pages that are
+   already filled with zeros, for single-page PAL_ZERO requests.
+   The idle thread refills it, a page each time it finds nothing
+   else to run, so that the zeroing happens while the CPU would
+   otherwise be idle rather than on the fault or fork path that
+   needs the page, and never competes with a ready thread under
+   any scheduler.  The refill leaves the last ZERO_RESERVE free
+   pages of a pool alone, and pre-zeroed pages are handed out like
+   any other if a request would fail without them. */
+
+/* Largest block order.  Blocks of 2**MAX_ORDER pages are 4 GB. */
+#define MAX_ORDER 20
+
+/* State of a page that does not begin a free block. */
+#define PAGE_USED 0xff
+
+/* Magazine capacity, and the number of pages moved
+   between a magazine and its pool at once. */
+#define MAG_SIZE 32
+#define MAG_BATCH 16
+
+/* Capacity of a pool's stack of pre-zeroed pages, and the number
+   of free pages that refilling it must leave in the pool. */
+#define ZERO_MAX 64
+#define ZERO_RESERVE (4 * ZERO_MAX)
+
+/* A magazine of free single pages. */
+struct magazine {
+	void *pages[MAG_SIZE];          /* Free pages, most recent last. */
+	int cnt;                        /* Number of pages. */
+};
 
 /* A memory pool. */
 struct pool {
 	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	uint8_t *state;                 /* Per-page state. */
+	struct list_elem *elems;        /* Per-page free list elements. */
+	struct list free_list[MAX_ORDER + 1]; /* Free blocks by order. */
+	size_t page_cnt;                /* Number of pages in pool. */
+	size_t free_cnt;                /* Number of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+
+	/* Protected by disabling interrupts rather than by LOCK. */
+	struct magazine mag;            /* Free single pages. */
+	uint64_t mag_hits;              /* Pages got from a magazine. */
+	uint64_t mag_misses;            /* Refills of an empty magazine. */
+	uint64_t mag_drains;            /* Drains of a full magazine. */
+
+	/* Also protected by disabling interrupts. */
+	void *zeroed[ZERO_MAX];         /* Pre-zeroed pages. */
+	int zeroed_cnt;                 /* Number of pre-zeroed pages. */
+	uint64_t zero_hits;             /* PAL_ZERO pages taken pre-zeroed. */
+	uint64_t zero_misses;           /* PAL_ZERO pages zeroed on demand. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -38,10 +111,20 @@ static struct pool kernel_pool, user_pool;
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
+
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static void pool_free (struct pool *, size_t page_idx, size_t page_cnt);
+static bool pool_claim (struct pool *, size_t page_idx, size_t page_cnt);
+static void *magazine_get (struct pool *);
+static void magazine_put (struct pool *, void *page);
+static void magazine_drain_all (struct pool *);
+static void *zeroed_get (struct pool *, bool count);
+static void zeroed_drain_all (struct pool *);
+static bool zero_one (struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -219,16 +302,16 @@ split:
 			else
 				NOT_REACHED ();
 
-			pool_end = pool->base + bitmap_size (pool->used_map) * PGSIZE;
+			pool_end = pool->base + pool->page_cnt * PGSIZE;
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -263,19 +346,47 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
-	void *pages;
+	void *pages = NULL;
 
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	if (page_cnt == 0)
+		return NULL;
+
+	if (page_cnt == 1 && (flags & PAL_ZERO)) {
+		pages = zeroed_get (pool, true);
+		if (pages != NULL)
+			return pages;
+	}
+
+	if (page_cnt == 1) {
+		pages = magazine_get (pool);
+		if (pages == NULL) {
+			/* Take a pre-zeroed page rather than fail. */
+			pages = zeroed_get (pool, false);
+			if (pages != NULL)
+				return pages;
+		}
+	} else {
+		lock_acquire (&pool->lock);
+		size_t page_idx = pool_alloc (pool, page_cnt);
+		lock_release (&pool->lock);
+
+		if (page_idx == SIZE_MAX) {
+			/* The pages we lack may be sitting in the magazine or
+			   pre-zeroed. */
+			magazine_drain_all (pool);
+			zeroed_drain_all (pool);
+			lock_acquire (&pool->lock);
+			page_idx = pool_alloc (pool, page_cnt);
+			lock_release (&pool->lock);
+		}
+		if (page_idx != SIZE_MAX)
+			pages = pool->base + PGSIZE * page_idx;
+	}
 
 	if (pages) {
 		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+			for (size_t i = 0; i < page_cnt; i++)
+				clear_page (pages + PGSIZE * i);
 	} else {
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
@@ -284,6 +395,16 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	return pages;
 }
 
+/* Called by the idle thread, with interrupts off, when no other
+   thread is ready to run.  Zeroes one page for a pool's
+   pre-zeroed stack and returns true, or returns false if there is
+   nothing to do.  Never blocks, since the idle thread must not;
+   a page is quick enough to zero with interrupts off. */
+bool
+palloc_zero_idle (void) {
+	return zero_one (&kernel_pool) || zero_one (&user_pool);
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -318,8 +439,43 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
-	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	if (page_cnt == 1) {
+		magazine_put (pool, pages);
+		return;
+	}
+	lock_acquire (&pool->lock);
+	pool_free (pool, page_idx, page_cnt);
+	lock_release (&pool->lock);
+}
+
+/* Extends the PAGE_CNT pages starting at PAGES, which must have
+   been allocated together, to NEW_CNT pages in place.  Succeeds,
+   returning true, only if the pages that follow them are free.
+   The new pages are not zeroed. */
+bool
+palloc_grow (void *pages, size_t page_cnt, size_t new_cnt) {
+	struct pool *pool;
+	size_t page_idx;
+	bool success;
+
+	ASSERT (pg_ofs (pages) == 0);
+	ASSERT (new_cnt >= page_cnt);
+
+	if (page_from_pool (&kernel_pool, pages))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, pages))
+		pool = &user_pool;
+	else
+		NOT_REACHED ();
+
+	page_idx = pg_no (pages) - pg_no (pool->base) + page_cnt;
+	if (page_idx + (new_cnt - page_cnt) > pool->page_cnt)
+		return false;
+
+	lock_acquire (&pool->lock);
+	success = pool_claim (pool, page_idx, new_cnt - page_cnt);
+	lock_release (&pool->lock);
+	return success;
 }
 
 /* Frees the page at PAGE. */
@@ -328,23 +484,78 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of free pages in the user pool if PAL_USER
+   is set in FLAGS, otherwise in the kernel pool, counting those
+   in the magazine and those pre-zeroed. */
+size_t
+palloc_free_cnt (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	return pool->free_cnt + pool->mag.cnt + pool->zeroed_cnt;
+}
+
+/* Fills the page at PAGE, which must be page-aligned, with
+   zeros. */
+void
+clear_page (void *page) {
+	size_t quads = PGSIZE / 8;
+
+	ASSERT (pg_ofs (page) == 0);
+	asm volatile ("rep stosq"
+			: "+D" (page), "+c" (quads)
+			: "a" (0)
+			: "memory");
+}
+
+/* Copies the page at SRC to the page at DST.  Both must be
+   page-aligned. */
+void
+copy_page (void *dst, const void *src) {
+	size_t quads = PGSIZE / 8;
+
+	ASSERT (pg_ofs (dst) == 0 && pg_ofs (src) == 0);
+	asm volatile ("rep movsq"
+			: "+D" (dst), "+S" (src), "+c" (quads)
+			:
+			: "memory");
+}
+
+/* Prints page magazine statistics. */
+void
+palloc_print_stats (void) {
+	printf ("Page magazines: kernel %llu hits, %llu misses, %llu drains; "
+			"user %llu hits, %llu misses, %llu drains\n",
+			kernel_pool.mag_hits, kernel_pool.mag_misses, kernel_pool.mag_drains,
+			user_pool.mag_hits, user_pool.mag_misses, user_pool.mag_drains);
+	printf ("Zeroed pages: kernel %llu pre-zeroed, %llu zeroed on demand; "
+			"user %llu pre-zeroed, %llu zeroed on demand\n",
+			kernel_pool.zero_hits, kernel_pool.zero_misses,
+			user_pool.zero_hits, user_pool.zero_misses);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
+  /* We'll put the pool's page states and list elements at
+     *BM_BASE.  Calculate the space needed for them and advance
+     *BM_BASE past it. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t elem_bytes = ROUND_UP (pgcnt * sizeof *p->elems, PGSIZE);
+	size_t state_bytes = ROUND_UP (pgcnt, PGSIZE);
+	int order;
 
 	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->elems = *bm_base;
+	p->state = *bm_base + elem_bytes;
+	for (order = 0; order <= MAX_ORDER; order++)
+		list_init (&p->free_list[order]);
+	p->page_cnt = pgcnt;
+	p->free_cnt = 0;
 	p->base = (void *) start;
 
 	// Mark all to unusable.
-	bitmap_set_all(p->used_map, true);
+	memset (p->state, PAGE_USED, pgcnt);
 
-	*bm_base += bm_pages;
+	*bm_base += elem_bytes + state_bytes;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -353,6 +564,309 @@ static bool
 page_from_pool (const struct pool *pool, void *page) {
 	size_t page_no = pg_no (page);
 	size_t start_page = pg_no (pool->base);
-	size_t end_page = start_page + bitmap_size (pool->used_map);
+	size_t end_page = start_page + pool->page_cnt;
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the list element of the free block of POOL that begins
+   at page PAGE_IDX. */
+static struct list_elem *
+block_elem (const struct pool *pool, size_t page_idx) {
+	return &pool->elems[page_idx];
+}
+
+/* Returns the index of the page that begins the free block of
+   POOL whose list element is ELEM. */
+static size_t
+block_idx (const struct pool *pool, struct list_elem *elem) {
+	return elem - pool->elems;
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX to POOL's free
+   lists, merged with its buddies as far as they are free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) {
+	while (order < MAX_ORDER) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy + ((size_t) 1 << order) > pool->page_cnt
+				|| pool->state[buddy] != order)
+			break;
+		list_remove (block_elem (pool, buddy));
+		pool->state[buddy] = PAGE_USED;
+		page_idx &= ~((size_t) 1 << order);
+		order++;
+	}
+	pool->state[page_idx] = order;
+	list_push_front (&pool->free_list[order], block_elem (pool, page_idx));
+}
+
+/* Frees the PAGE_CNT pages of POOL starting at PAGE_IDX, as the
+   largest aligned blocks that cover them.  The pool's lock must be
+   held, or the pool not yet in use. */
+static void
+pool_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	ASSERT (page_idx + page_cnt <= pool->page_cnt);
+
+	pool->free_cnt += page_cnt;
+	while (page_cnt > 0) {
+		int order = page_idx != 0 ? __builtin_ctzll (page_idx) : MAX_ORDER;
+		int fit = 63 - __builtin_clzll (page_cnt);
+
+		if (order > fit)
+			order = fit;
+		if (order > MAX_ORDER)
+			order = MAX_ORDER;
+		ASSERT (pool->state[page_idx] == PAGE_USED);
+		free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or SIZE_MAX if there is no free block large
+   enough.  The pool's lock must be held. */
+static size_t
+pool_alloc (struct pool *pool, size_t page_cnt) {
+	int want = page_cnt > 1 ? 64 - __builtin_clzll (page_cnt - 1) : 0;
+	int order;
+	size_t page_idx;
+
+	for (order = want; order <= MAX_ORDER; order++)
+		if (!list_empty (&pool->free_list[order]))
+			break;
+	if (order > MAX_ORDER)
+		return SIZE_MAX;
+
+	/* Take the block and split off halves until it has the order
+	   we want. */
+	page_idx = block_idx (pool, list_pop_front (&pool->free_list[order]));
+	pool->state[page_idx] = PAGE_USED;
+	while (order > want) {
+		size_t half;
+
+		order--;
+		half = page_idx + ((size_t) 1 << order);
+		pool->state[half] = order;
+		list_push_front (&pool->free_list[order], block_elem (pool, half));
+	}
+
+	/* Give back the pages beyond PAGE_CNT. */
+	pool->free_cnt -= (size_t) 1 << want;
+	pool_free (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+	return page_idx;
+}
+
+/* Returns the order of the free block of POOL that contains page
+   PAGE_IDX, or -1 if that page is not free. */
+static int
+containing_block (const struct pool *pool, size_t page_idx) {
+	int order;
+
+	for (order = 0; order <= MAX_ORDER; order++) {
+		size_t start = page_idx & ~(((size_t) 1 << order) - 1);
+		if (pool->state[start] == order)
+			return order;
+	}
+	return -1;
+}
+
+/* Allocates the PAGE_CNT pages of POOL starting at PAGE_IDX, if
+   they are all free, and returns true; otherwise returns false.
+   Each free block that overlaps them is taken off its free list
+   and the parts of it outside them are freed again.  The pool's
+   lock must be held. */
+static bool
+pool_claim (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	size_t end = page_idx + page_cnt;
+	size_t idx;
+
+	/* Every page must be in some free block. */
+	for (idx = page_idx; idx < end; ) {
+		int order = containing_block (pool, idx);
+		if (order < 0)
+			return false;
+		idx = (idx & ~(((size_t) 1 << order) - 1)) + ((size_t) 1 << order);
+	}
+
+	for (idx = page_idx; idx < end; ) {
+		int order = containing_block (pool, idx);
+		size_t start = idx & ~(((size_t) 1 << order) - 1);
+		size_t block_end = start + ((size_t) 1 << order);
+
+		list_remove (block_elem (pool, start));
+		pool->state[start] = PAGE_USED;
+		pool->free_cnt -= (size_t) 1 << order;
+		if (start < page_idx)
+			pool_free (pool, start, page_idx - start);
+		if (block_end > end)
+			pool_free (pool, end, block_end - end);
+		idx = block_end;
+	}
+	return true;
+}
+
+/* Returns the pages in BATCH[0] through BATCH[CNT - 1] to POOL. */
+static void
+pool_free_batch (struct pool *pool, void **batch, int cnt) {
+	int i;
+
+	lock_acquire (&pool->lock);
+	for (i = 0; i < cnt; i++)
+		pool_free (pool, pg_no (batch[i]) - pg_no (pool->base), 1);
+	lock_release (&pool->lock);
+}
+
+/* Takes a page from POOL's magazine, refilling the magazine from
+   POOL if it is empty.  Returns a null pointer if POOL has no
+   free page either. */
+static void *
+magazine_get (struct pool *pool) {
+	struct magazine *mag = &pool->mag;
+	void *batch[MAG_BATCH];
+	void *page = NULL;
+	enum intr_level old_level;
+	int cnt = 0;
+
+	old_level = intr_disable ();
+	if (mag->cnt > 0) {
+		page = mag->pages[--mag->cnt];
+		pool->mag_hits++;
+	} else
+		pool->mag_misses++;
+	intr_set_level (old_level);
+	if (page != NULL)
+		return page;
+
+	lock_acquire (&pool->lock);
+	while (cnt < MAG_BATCH) {
+		size_t page_idx = pool_alloc (pool, 1);
+		if (page_idx == SIZE_MAX)
+			break;
+		batch[cnt++] = pool->base + PGSIZE * page_idx;
+	}
+	lock_release (&pool->lock);
+	if (cnt == 0)
+		return NULL;
+
+	/* Keep one page, and stock the magazine with the rest.  Another
+	   thread may have filled it while we held the lock. */
+	page = batch[--cnt];
+	old_level = intr_disable ();
+	while (cnt > 0 && mag->cnt < MAG_SIZE)
+		mag->pages[mag->cnt++] = batch[--cnt];
+	intr_set_level (old_level);
+	if (cnt > 0)
+		pool_free_batch (pool, batch, cnt);
+	return page;
+}
+
+/* Puts free PAGE in POOL's magazine.  If the magazine is full,
+   returns PAGE and the magazine's MAG_BATCH - 1 oldest pages to
+   POOL instead. */
+static void
+magazine_put (struct pool *pool, void *page) {
+	struct magazine *mag = &pool->mag;
+	void *batch[MAG_BATCH];
+	enum intr_level old_level;
+	int cnt = 0;
+
+	old_level = intr_disable ();
+	if (mag->cnt < MAG_SIZE)
+		mag->pages[mag->cnt++] = page;
+	else {
+		int i;
+
+		pool->mag_drains++;
+		for (i = 0; i < MAG_BATCH - 1; i++)
+			batch[cnt++] = mag->pages[i];
+		for (i = MAG_BATCH - 1; i < MAG_SIZE; i++)
+			mag->pages[i - (MAG_BATCH - 1)] = mag->pages[i];
+		mag->cnt -= MAG_BATCH - 1;
+		batch[cnt++] = page;
+	}
+	intr_set_level (old_level);
+	if (cnt > 0)
+		pool_free_batch (pool, batch, cnt);
+}
+
+/* Returns every page in POOL's magazine to POOL. */
+static void
+magazine_drain_all (struct pool *pool) {
+	struct magazine *mag = &pool->mag;
+	void *batch[MAG_SIZE];
+	enum intr_level old_level;
+	int cnt;
+
+	old_level = intr_disable ();
+	cnt = mag->cnt;
+	memcpy (batch, mag->pages, cnt * sizeof *batch);
+	mag->cnt = 0;
+	intr_set_level (old_level);
+	if (cnt > 0)
+		pool_free_batch (pool, batch, cnt);
+}
+
+/* Takes a page from POOL's pre-zeroed stack, or returns a null
+   pointer if it is empty.  If COUNT, records whether the caller
+   was spared zeroing a page. */
+static void *
+zeroed_get (struct pool *pool, bool count) {
+	enum intr_level old_level;
+	void *page = NULL;
+
+	old_level = intr_disable ();
+	if (pool->zeroed_cnt > 0)
+		page = pool->zeroed[--pool->zeroed_cnt];
+	if (count) {
+		if (page != NULL)
+			pool->zero_hits++;
+		else
+			pool->zero_misses++;
+	}
+	intr_set_level (old_level);
+	return page;
+}
+
+/* Returns every page in POOL's pre-zeroed stack to POOL. */
+static void
+zeroed_drain_all (struct pool *pool) {
+	void *batch[ZERO_MAX];
+	enum intr_level old_level;
+	int cnt;
+
+	old_level = intr_disable ();
+	cnt = pool->zeroed_cnt;
+	memcpy (batch, pool->zeroed, cnt * sizeof *batch);
+	pool->zeroed_cnt = 0;
+	intr_set_level (old_level);
+	if (cnt > 0)
+		pool_free_batch (pool, batch, cnt);
+}
+
+/* Zeroes one free page of POOL onto its pre-zeroed stack, unless
+   the stack is full, POOL is down to ZERO_RESERVE free pages, or
+   another thread holds POOL's lock.  Returns true if it zeroed a
+   page.  Interrupts must be off. */
+static bool
+zero_one (struct pool *pool) {
+	size_t page_idx;
+	void *page;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (pool->zeroed_cnt >= ZERO_MAX || pool->free_cnt <= ZERO_RESERVE)
+		return false;
+	if (!lock_try_acquire (&pool->lock))
+		return false;
+	page_idx = pool_alloc (pool, 1);
+	lock_release (&pool->lock);
+	if (page_idx == SIZE_MAX)
+		return false;
+
+	page = pool->base + PGSIZE * page_idx;
+	clear_page (page);
+	pool->zeroed[pool->zeroed_cnt++] = page;
+	return true;
+}
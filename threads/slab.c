@@ -0,0 +1,318 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Object caches, after Bonwick's slab allocator.
+
+   malloc() rounds every request up to a power of two, so a
+   560-byte struct inode takes a 1 kB block, and every call goes
+   through the shared descriptor for that size.  A kmem_cache
+   instead serves objects of one type and size.  Its memory comes
+   from the page allocator one page, or "slab", at a time: a
+   struct slab header at the start of the page, then an array of
+   free-object indexes, then as many objects as fit.
+
+   The free chain lives in that index array rather than in the
+   free objects themselves, so a freed object keeps its contents.
+   A cache with a constructor runs it once on every object when
+   the slab is created, and from then on hands objects out, and
+   takes them back, in their constructed state.
+
+   Each cache keeps its slabs on three lists: full, partial and
+   empty.  Allocation takes from the first partial slab, so live
+   objects pack into as few slabs as possible.  One empty slab is
+   kept for the next allocation; further ones are given back to
+   the page allocator as they empty out.
+
+   Slabs rarely fill their page exactly.  The bytes left over are
+   used to "color" the slab: each new slab starts its objects
+   COLOR_STEP bytes further into the page than the one before,
+   wrapping around when the leftover runs out.  Objects at the
+   same index in different slabs then fall into different cache
+   sets instead of all contending for the same few. */
+
+/* Distance between successive slab colors, in bytes.  This is
+   the size of a cache line. */
+#define COLOR_STEP 64
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Marks the end of a slab's free chain. */
+#define SLAB_END UINT16_MAX
+
+/* An object cache. */
+struct kmem_cache {
+	char name[16];              /* Name, for statistics. */
+	size_t size;                /* Object size, a multiple of ALIGN. */
+	size_t align;               /* Object alignment. */
+	kmem_ctor_func *ctor;       /* Constructor, or null. */
+	size_t objs_per_slab;       /* Objects in each slab. */
+	size_t first_obj;           /* Offset of first object, uncolored. */
+	size_t colors;              /* Number of distinct colors. */
+	size_t next_color;          /* Color of the next slab. */
+
+	struct lock lock;           /* Protects the members below. */
+	struct list full;           /* Slabs with no free objects. */
+	struct list partial;        /* Slabs with some free objects. */
+	struct list empty;          /* Slabs with no objects in use. */
+
+	/* Statistics. */
+	size_t active;              /* Objects in use. */
+	size_t slab_cnt;            /* Slabs owned. */
+	unsigned long long allocs;  /* Calls to kmem_cache_alloc(). */
+	unsigned long long frees;   /* Calls to kmem_cache_free(). */
+	unsigned long long grows;   /* Slabs obtained from palloc. */
+
+	struct list_elem elem;      /* Element in cache_list. */
+};
+
+/* A slab, at the start of its page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in one of cache's lists. */
+	uint8_t *objs;              /* First object. */
+	size_t inuse;               /* Number of objects in use. */
+	uint16_t free;              /* First free object, or SLAB_END. */
+	uint16_t next[];            /* Next free object after each one. */
+};
+
+/* All caches, for slab_print_stats(). */
+static struct list cache_list;
+static struct lock cache_list_lock;
+
+static struct slab *slab_create (struct kmem_cache *);
+static void slab_destroy (struct slab *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Initializes the cache list. */
+void
+slab_init (void) {
+	list_init (&cache_list);
+	lock_init (&cache_list_lock);
+}
+
+/* Creates and returns a cache of objects of SIZE bytes, each
+   aligned on an ALIGN-byte boundary, or on a pointer boundary if
+   ALIGN is 0.  If CTOR is nonnull, it is run on every object when
+   the cache first obtains it.  NAME is used for statistics only.
+   Panics if memory is not available. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, size_t align,
+		kmem_ctor_func *ctor) {
+	struct kmem_cache *c;
+	size_t n, leftover;
+
+	if (align == 0)
+		align = sizeof (void *);
+	ASSERT ((align & (align - 1)) == 0);
+	ASSERT (size > 0 && size <= PGSIZE / 4);
+
+	c = malloc (sizeof *c);
+	if (c == NULL)
+		PANIC ("kmem_cache_create: out of memory");
+	strlcpy (c->name, name, sizeof c->name);
+	c->size = ROUND_UP (size, align);
+	c->align = align;
+	c->ctor = ctor;
+
+	/* Fit as many objects as we can after the header and its
+	   index array, then spread what is left over among colors. */
+	n = (PGSIZE - sizeof (struct slab)) / (c->size + sizeof (uint16_t));
+	while (ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t), align)
+			+ n * c->size > PGSIZE)
+		n--;
+	ASSERT (n > 0 && n < SLAB_END);
+	c->objs_per_slab = n;
+	c->first_obj = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+			align);
+	leftover = PGSIZE - c->first_obj - n * c->size;
+	c->colors = leftover / ROUND_UP (COLOR_STEP, align) + 1;
+	c->next_color = 0;
+
+	lock_init (&c->lock);
+	list_init (&c->full);
+	list_init (&c->partial);
+	list_init (&c->empty);
+	c->active = c->slab_cnt = 0;
+	c->allocs = c->frees = c->grows = 0;
+
+	lock_acquire (&cache_list_lock);
+	list_push_back (&cache_list, &c->elem);
+	lock_release (&cache_list_lock);
+	return c;
+}
+
+/* Obtains and returns an object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	uint16_t idx;
+
+	ASSERT (c != NULL);
+
+	lock_acquire (&c->lock);
+	if (list_empty (&c->partial)) {
+		if (!list_empty (&c->empty))
+			s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+		else {
+			s = slab_create (c);
+			if (s == NULL) {
+				lock_release (&c->lock);
+				return NULL;
+			}
+		}
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	/* Take the first free object of the first partial slab. */
+	s = list_entry (list_front (&c->partial), struct slab, elem);
+	idx = s->free;
+	ASSERT (idx != SLAB_END);
+	s->free = s->next[idx];
+	if (++s->inuse == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	c->active++;
+	c->allocs++;
+	lock_release (&c->lock);
+
+	return s->objs + idx * c->size;
+}
+
+/* Returns OBJ, which must have been obtained from cache C, to C.
+   If C has a constructor, OBJ must be in its constructed state. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+	uint16_t idx;
+
+	if (obj == NULL)
+		return;
+
+	s = obj_to_slab (c, obj);
+	idx = ((uint8_t *) obj - s->objs) / c->size;
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   it has to keep its constructed state. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->size);
+#endif
+
+	lock_acquire (&c->lock);
+	s->next[idx] = s->free;
+	s->free = idx;
+	if (s->inuse-- == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	if (s->inuse == 0) {
+		/* Keep one empty slab around; release any others. */
+		list_remove (&s->elem);
+		if (list_empty (&c->empty))
+			list_push_front (&c->empty, &s->elem);
+		else
+			slab_destroy (s);
+	}
+	c->active--;
+	c->frees++;
+	lock_release (&c->lock);
+}
+
+/* Gives every empty slab of cache C back to the page allocator. */
+void
+kmem_cache_shrink (struct kmem_cache *c) {
+	lock_acquire (&c->lock);
+	while (!list_empty (&c->empty))
+		slab_destroy (list_entry (list_pop_front (&c->empty),
+					struct slab, elem));
+	lock_release (&c->lock);
+}
+
+/* Prints object cache statistics. */
+void
+slab_print_stats (void) {
+	struct list_elem *e;
+
+	lock_acquire (&cache_list_lock);
+	for (e = list_begin (&cache_list); e != list_end (&cache_list);
+			e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+		printf ("Slab %s: %zu of %zu %zu-byte objects in use, %zu slabs; "
+				"%llu allocs, %llu frees, %llu grows\n",
+				c->name, c->active, c->slab_cnt * c->objs_per_slab, c->size,
+				c->slab_cnt, c->allocs, c->frees, c->grows);
+	}
+	lock_release (&cache_list_lock);
+}
+
+/* Obtains a page for cache C, which must be locked, and sets it
+   up as an empty slab with every object constructed.
+   Returns a null pointer if memory is not available. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	size_t i;
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->objs = (uint8_t *) s + c->first_obj
+		+ c->next_color * ROUND_UP (COLOR_STEP, c->align);
+	s->inuse = 0;
+	if (++c->next_color >= c->colors)
+		c->next_color = 0;
+
+	s->free = 0;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		s->next[i] = i + 1 < c->objs_per_slab ? i + 1 : SLAB_END;
+		if (c->ctor != NULL)
+			c->ctor (s->objs + i * c->size);
+	}
+
+	c->slab_cnt++;
+	c->grows++;
+	return s;
+}
+
+/* Gives slab S, which has no objects in use and is on no list,
+   back to the page allocator.  Its cache must be locked. */
+static void
+slab_destroy (struct slab *s) {
+	ASSERT (s->inuse == 0);
+	s->cache->slab_cnt--;
+	s->magic = 0;
+	palloc_free_page (s);
+}
+
+/* Returns the slab that object OBJ, which must belong to cache C,
+   is in. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	/* Check that the slab is valid. */
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+
+	/* Check that the object is properly aligned for the slab. */
+	ASSERT ((uint8_t *) obj >= s->objs);
+	ASSERT (((uint8_t *) obj - s->objs) % c->size == 0);
+
+	return s;
+}
@@ -0,0 +1,345 @@
+#include "threads/smp.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Multiprocessor bring-up.
+
+   The processors are enumerated from the ACPI MADT ("APIC"
+   table), and every application processor (AP) is started with
+   the INIT-SIPI-SIPI sequence through its local APIC.  Each AP
+   runs threads/trampoline.S, switches to the kernel page table,
+   loads the IDT, marks itself online and parks in "cli; hlt".
+
+   The APs do not schedule threads: the rest of the kernel
+   achieves mutual exclusion by disabling interrupts, which only
+   excludes the local CPU, so every thread runs on the bootstrap
+   processor. */
+
+/* -smp: Start the application processors? */
+bool smp_enabled;
+
+/* Processors.  Until smp_init() says otherwise, there is only
+   the bootstrap processor. */
+struct cpu cpus[CPU_MAX] = { { .id = 0, .lapic_id = 0, .online = true } };
+int cpu_cnt = 1;
+
+/* ACPI Root System Description Pointer. */
+struct acpi_rsdp {
+	char signature[8];          /* "RSD PTR ". */
+	uint8_t checksum;
+	char oem_id[6];
+	uint8_t revision;
+	uint32_t rsdt_addr;         /* Physical address of the RSDT. */
+} __attribute__ ((packed));
+
+/* Header common to every ACPI System Description Table. */
+struct acpi_sdt {
+	char signature[4];
+	uint32_t length;            /* Including this header. */
+	uint8_t revision;
+	uint8_t checksum;
+	char oem_id[6];
+	char oem_table_id[8];
+	uint32_t oem_revision;
+	uint32_t creator_id;
+	uint32_t creator_revision;
+} __attribute__ ((packed));
+
+/* Multiple APIC Description Table. */
+struct acpi_madt {
+	struct acpi_sdt header;
+	uint32_t lapic_addr;        /* Physical address of the local APICs. */
+	uint32_t flags;
+	/* Followed by variable length entries. */
+} __attribute__ ((packed));
+
+/* MADT entry, type 0: processor local APIC. */
+#define MADT_LAPIC 0
+#define MADT_LAPIC_ENABLED 0x1
+struct madt_lapic {
+	uint8_t type;
+	uint8_t length;
+	uint8_t acpi_id;
+	uint8_t apic_id;
+	uint32_t flags;
+} __attribute__ ((packed));
+
+/* Local APIC registers, as byte offsets. */
+#define LAPIC_ID     0x020      /* ID. */
+#define LAPIC_ICR_LO 0x300      /* Interrupt Command, bits 0-31. */
+#define LAPIC_ICR_HI 0x310      /* Interrupt Command, bits 32-63. */
+
+/* Interrupt Command Register bits. */
+#define ICR_INIT     0x00000500 /* INIT delivery mode. */
+#define ICR_STARTUP  0x00000600 /* Startup IPI delivery mode. */
+#define ICR_DELIVS   0x00001000 /* Delivery status: send pending. */
+#define ICR_ASSERT   0x00004000 /* Level assert. */
+
+/* Local APIC registers, mapped uncached. */
+static volatile uint32_t *lapic;
+
+/* Page table handed to the APs by the trampoline.  Same as
+   base_pml4, plus an identity mapping of the first 2 MB so that
+   the trampoline keeps running when paging is turned on. */
+static uint64_t *ap_pml4;
+
+/* GDT the APs switch to once in the kernel.  Same layout as the
+   temporary GDT loaded by thread_init(). */
+static uint64_t ap_gdt[3] = { 0, 0x00af9a000000ffff, 0x00cf92000000ffff };
+
+/* Defined in trampoline.S. */
+extern char ap_trampoline[], ap_trampoline_end[];
+extern char ap_cr3[], ap_stack[], ap_entry[], ap_arg[];
+
+static bool acpi_find_cpus (void);
+static void map_phys (uint64_t pa, size_t size, uint64_t flags);
+static void build_ap_pml4 (void);
+static bool start_ap (struct cpu *);
+static void ap_main (struct cpu *) NO_RETURN;
+
+/* Finds the processors and boots all application processors.
+   Must be called with interrupts on, after timer_calibrate(). */
+void
+smp_init (void) {
+	if (!acpi_find_cpus ()) {
+		printf ("smp: no usable ACPI MADT, running on one CPU\n");
+		return;
+	}
+
+	build_ap_pml4 ();
+	memcpy (ptov (AP_TRAMPOLINE), ap_trampoline,
+			ap_trampoline_end - ap_trampoline);
+
+	for (int i = 1; i < cpu_cnt; i++)
+		if (!start_ap (&cpus[i]))
+			printf ("smp: cpu %d (apic %d) did not start\n",
+					i, cpus[i].lapic_id);
+
+	printf ("smp: %d of %d CPUs online\n", smp_online_cnt (), cpu_cnt);
+}
+
+/* Returns the number of processors that finished booting. */
+int
+smp_online_cnt (void) {
+	int cnt = 0;
+	for (int i = 0; i < cpu_cnt; i++)
+		if (cpus[i].online)
+			cnt++;
+	return cnt;
+}
+
+/* Returns true if the SIZE bytes at physical address PA sum to
+   zero, as every ACPI structure must. */
+static bool
+acpi_checksum (uint64_t pa, size_t size) {
+	const uint8_t *p = ptov (pa);
+	uint8_t sum = 0;
+	for (size_t i = 0; i < size; i++)
+		sum += p[i];
+	return sum == 0;
+}
+
+/* Searches for the RSDP in the SIZE bytes at physical address
+   PA, which must already be mapped.  Returns its physical
+   address, or 0 if not found. */
+static uint64_t
+acpi_scan_rsdp (uint64_t pa, size_t size) {
+	for (uint64_t p = pa; p + sizeof (struct acpi_rsdp) <= pa + size; p += 16)
+		if (!memcmp (ptov (p), "RSD PTR ", 8)
+				&& acpi_checksum (p, sizeof (struct acpi_rsdp)))
+			return p;
+	return 0;
+}
+
+/* Maps the ACPI table at physical address PA and returns it
+   if its checksum is valid, otherwise a null pointer. */
+static struct acpi_sdt *
+acpi_map_sdt (uint64_t pa) {
+	struct acpi_sdt *sdt;
+
+	map_phys (pa, sizeof *sdt, PTE_W);
+	sdt = ptov (pa);
+	map_phys (pa, sdt->length, PTE_W);
+	return acpi_checksum (pa, sdt->length) ? sdt : NULL;
+}
+
+/* Fills in cpus[] and maps the local APIC from the MADT.
+   Returns false if the table is missing or lists only one
+   processor. */
+static bool
+acpi_find_cpus (void) {
+	struct acpi_rsdp *rsdp;
+	struct acpi_sdt *rsdt;
+	struct acpi_madt *madt = NULL;
+	uint64_t pa;
+
+	/* The RSDP is in the first KB of the EBDA or in the BIOS
+	   area from 0xe0000 to 0xfffff.  Both are in low memory, which
+	   paging_init() has mapped. */
+	pa = acpi_scan_rsdp ((uint64_t) *(uint16_t *) ptov (0x40e) << 4, 1024);
+	if (pa == 0)
+		pa = acpi_scan_rsdp (0xe0000, 0x20000);
+	if (pa == 0)
+		return false;
+	rsdp = ptov (pa);
+
+	rsdt = acpi_map_sdt (rsdp->rsdt_addr);
+	if (rsdt == NULL || memcmp (rsdt->signature, "RSDT", 4))
+		return false;
+	uint32_t *entries = (uint32_t *) (rsdt + 1);
+	size_t entry_cnt = (rsdt->length - sizeof *rsdt) / sizeof *entries;
+	for (size_t i = 0; i < entry_cnt && madt == NULL; i++) {
+		struct acpi_sdt *sdt = acpi_map_sdt (entries[i]);
+		if (sdt != NULL && !memcmp (sdt->signature, "APIC", 4))
+			madt = (struct acpi_madt *) sdt;
+	}
+	if (madt == NULL)
+		return false;
+
+	/* Map the local APIC uncached. */
+	map_phys (madt->lapic_addr, PGSIZE, PTE_W | PTE_PCD | PTE_PWT);
+	lapic = ptov (madt->lapic_addr);
+	uint8_t bsp_id = lapic[LAPIC_ID / 4] >> 24;
+
+	/* The bootstrap processor stays cpus[0]; every other enabled
+	   processor is appended. */
+	cpus[0].lapic_id = bsp_id;
+	uint8_t *p = (uint8_t *) (madt + 1);
+	uint8_t *end = (uint8_t *) madt + madt->header.length;
+	while (p + 2 <= end && p[1] != 0) {
+		struct madt_lapic *e = (struct madt_lapic *) p;
+		if (e->type == MADT_LAPIC && (e->flags & MADT_LAPIC_ENABLED)
+				&& e->apic_id != bsp_id) {
+			if (cpu_cnt < CPU_MAX) {
+				struct cpu *c = &cpus[cpu_cnt];
+				c->id = cpu_cnt++;
+				c->lapic_id = e->apic_id;
+				c->online = false;
+			} else
+				printf ("smp: ignoring cpu with apic %d\n", e->apic_id);
+		}
+		p += p[1];
+	}
+	return cpu_cnt > 1;
+}
+
+/* Maps the SIZE bytes at physical address PA at ptov(PA) in
+   base_pml4, with the given FLAGS.  Pages already mapped (such
+   as those under the end of RAM) are left alone. */
+static void
+map_phys (uint64_t pa, size_t size, uint64_t flags) {
+	for (uint64_t p = pa & ~PGMASK; p < pa + size; p += PGSIZE) {
+		uint64_t *pte = pml4e_walk (base_pml4, (uint64_t) ptov (p), 1);
+		if (pte == NULL)
+			PANIC ("smp: out of memory mapping %#llx", p);
+		if (!(*pte & PTE_P))
+			*pte = p | flags | PTE_P;
+	}
+}
+
+/* Builds ap_pml4.  The trampoline loads it with a 32-bit mov to
+   %cr3, so every page must be below 4 GB. */
+static void
+build_ap_pml4 (void) {
+	uint64_t *pdpt, *pd;
+
+	ap_pml4 = palloc_get_page (PAL_ASSERT);
+	pdpt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	pd = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	ASSERT (vtop (ap_pml4) < 0x100000000ULL);
+
+	copy_page (ap_pml4, base_pml4);
+	ASSERT (!(ap_pml4[0] & PTE_P));
+	pd[0] = 0 | PTE_PS | PTE_W | PTE_P;
+	pdpt[0] = vtop (pd) | PTE_W | PTE_P;
+	ap_pml4[0] = vtop (pdpt) | PTE_W | PTE_P;
+}
+
+/* Writes V to local APIC register REG, and waits for the write
+   to complete by reading back the ID register. */
+static void
+lapic_write (int reg, uint32_t v) {
+	lapic[reg / 4] = v;
+	(void) lapic[LAPIC_ID / 4];
+}
+
+/* Sends interrupt command ICR to the processor with local APIC
+   ID APIC_ID and waits for it to be accepted. */
+static void
+lapic_ipi (uint8_t apic_id, uint32_t icr) {
+	lapic_write (LAPIC_ICR_HI, (uint32_t) apic_id << 24);
+	lapic_write (LAPIC_ICR_LO, icr);
+	while (lapic[LAPIC_ICR_LO / 4] & ICR_DELIVS)
+		asm volatile ("pause");
+}
+
+/* Boots application processor C and waits up to 100 ms for it
+   to come online. */
+static bool
+start_ap (struct cpu *c) {
+	void *stack = palloc_get_page (PAL_ASSERT);
+
+	*(uint64_t *) ptov (AP_TRAMPOLINE + (ap_cr3 - ap_trampoline))
+		= vtop (ap_pml4);
+	*(uint64_t *) ptov (AP_TRAMPOLINE + (ap_stack - ap_trampoline))
+		= (uint64_t) stack + PGSIZE;
+	*(uint64_t *) ptov (AP_TRAMPOLINE + (ap_entry - ap_trampoline))
+		= (uint64_t) ap_main;
+	*(uint64_t *) ptov (AP_TRAMPOLINE + (ap_arg - ap_trampoline))
+		= (uint64_t) c;
+
+	/* Universal startup algorithm from the MultiProcessor
+	   Specification, B.4. */
+	lapic_ipi (c->lapic_id, ICR_INIT | ICR_ASSERT);
+	timer_msleep (10);
+	for (int i = 0; i < 2; i++) {
+		lapic_ipi (c->lapic_id, ICR_STARTUP | ICR_ASSERT
+				| (AP_TRAMPOLINE >> 12));
+		timer_usleep (200);
+	}
+
+	for (int ms = 0; ms < 100 && !c->online; ms++)
+		timer_msleep (1);
+	if (!c->online)
+		palloc_free_page (stack);
+	return c->online;
+}
+
+/* First C code run by an application processor, on its own
+   stack but still on ap_pml4 and the trampoline's GDT.
+   Must not touch anything that assumes a running thread, which
+   includes printf(). */
+static void
+ap_main (struct cpu *c) {
+	struct desc_ptr gdt_ds = {
+		.size = sizeof ap_gdt - 1,
+		.address = (uint64_t) ap_gdt,
+	};
+
+	lgdt (&gdt_ds);
+	asm volatile ("movw %w0, %%ds\n"
+			"movw %w0, %%es\n"
+			"movw %w0, %%ss\n"
+			"pushq %1\n"
+			"movabs $1f, %%rax\n"
+			"pushq %%rax\n"
+			"lretq\n"
+			"1:\n"
+			: : "r" (0x10), "i" (0x08) : "rax", "memory");
+	lcr3 (vtop (base_pml4));
+	intr_init_ap ();
+
+	c->online = true;
+	for (;;)
+		asm volatile ("cli; hlt" : : : "memory");
+}
@@ -27,10 +27,16 @@
    */
 
 #include "threads/synch.h"
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+
+static bool waiter_less(const struct rb_elem *, const struct rb_elem *, void *aux);
+static bool held_lock_less(const struct rb_elem *, const struct rb_elem *, void *aux);
+static void lock_take(struct lock *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -46,7 +52,7 @@ void sema_init(struct semaphore *sema, unsigned value)
 	ASSERT(sema != NULL);
 
 	sema->value = value;
-	list_init(&sema->waiters);
+	rb_init(&sema->waiters);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -67,7 +73,12 @@ void sema_down(struct semaphore *sema)
 	old_level = intr_disable();
 	while (sema->value == 0)
 	{
-		list_insert_ordered(&sema->waiters, &thread_current()->elem, compare_thread_priority, NULL);
+		struct thread *cur = thread_current();
+
+		rb_insert(&sema->waiters, &cur->wait_elem, waiter_less, NULL);
+		cur->wait_sema = sema;
+		if (cur->wait_on_lock != NULL && &cur->wait_on_lock->semaphore == sema)
+			donate_priority();
 		thread_block();
 	}
 	sema->value--;
@@ -110,10 +121,13 @@ void sema_up(struct semaphore *sema)
 	ASSERT(sema != NULL);
 
 	old_level = intr_disable();
-	if (!list_empty(&sema->waiters))
+	if (!rb_empty(&sema->waiters))
 	{
-		list_sort(&sema->waiters, compare_thread_priority, NULL);
-		thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
+		struct thread *t = rb_entry(rb_min(&sema->waiters), struct thread, wait_elem);
+
+		rb_remove(&sema->waiters, &t->wait_elem);
+		t->wait_sema = NULL;
+		thread_unblock(t);
 	}
 	sema->value++;
 
@@ -177,6 +191,7 @@ void lock_init(struct lock *lock)
 
 	lock->holder = NULL;
 	sema_init(&lock->semaphore, 1);
+	lock->donation = PRI_MIN - 1;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -193,18 +208,19 @@ void lock_acquire(struct lock *lock)
 	ASSERT(!intr_context());
 	ASSERT(!lock_held_by_current_thread(lock));
 	struct thread *curr = thread_current();
-	
+	enum intr_level old_level;
+
+	/* While we wait, sema_down() donates our priority to the
+	   holder through wait_on_lock. */
+	old_level = intr_disable();
 	if (lock->holder != NULL)
-	{
-		curr->wait_on_lock = lock;
-		list_insert_ordered(&lock->holder->donations, &curr->donation_elem, compare_donation_priority, NULL);
-		if (!thread_mlfqs)
-			donate_priority();
-	}
+		trace_record(TRACE_CONTEND, curr, lock->holder->tid);
+	curr->wait_on_lock = lock;
 	sema_down(&lock->semaphore);
 	curr->wait_on_lock = NULL;
 
-	lock->holder = thread_current();
+	lock_take(lock);
+	intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -220,9 +236,11 @@ bool lock_try_acquire(struct lock *lock)
 	ASSERT(lock != NULL);
 	ASSERT(!lock_held_by_current_thread(lock));
 
+	enum intr_level old_level = intr_disable();
 	success = sema_try_down(&lock->semaphore);
 	if (success)
-		lock->holder = thread_current();
+		lock_take(lock);
+	intr_set_level(old_level);
 	return success;
 }
 
@@ -237,14 +255,31 @@ void lock_release(struct lock *lock)
 	ASSERT(lock != NULL);
 	ASSERT(lock_held_by_current_thread(lock));
 
+	enum intr_level old_level = intr_disable();
+	rb_remove(&thread_current()->held_locks, &lock->held_elem);
 	lock->holder = NULL;
+	refresh_priority(thread_current());
 
-	if (!thread_mlfqs)
-	{
-		remove_with_lock(lock);
-		refresh_priority();
-	}
 	sema_up(&lock->semaphore);
+	intr_set_level(old_level);
+}
+
+/* Makes the running thread the holder of LOCK, which it has just
+   downed, and lets the threads still waiting for LOCK donate to
+   it.  Interrupts must be off. */
+static void
+lock_take(struct lock *lock)
+{
+	struct thread *cur = thread_current();
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	lock->holder = cur;
+	lock->donation = PRI_MIN - 1;
+	if (!rb_empty(&lock->semaphore.waiters))
+		lock->donation = rb_entry(rb_min(&lock->semaphore.waiters), struct thread, wait_elem)->priority;
+	rb_insert(&cur->held_locks, &lock->held_elem, held_lock_less, NULL);
+	refresh_priority(cur);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -262,8 +297,11 @@ struct semaphore_elem
 {
 	struct list_elem elem;		/* List element. */
 	struct semaphore semaphore; /* This semaphore. */
+	struct thread *thread;		/* Thread waiting on semaphore. */
 };
 
+static bool semaphore_elem_less(const struct list_elem *, const struct list_elem *, void *aux);
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -304,8 +342,9 @@ void cond_wait(struct condition *cond, struct lock *lock)
 	ASSERT(lock_held_by_current_thread(lock));
 
 	sema_init(&waiter.semaphore, 0);
+	waiter.thread = thread_current();
 
-	list_insert_ordered(&cond->waiters, &waiter.elem, compare_semaphore_priority, NULL);
+	list_push_back(&cond->waiters, &waiter.elem);
 	lock_release(lock);
 	sema_down(&waiter.semaphore);
 	lock_acquire(lock);
@@ -327,10 +366,9 @@ void cond_signal(struct condition *cond, struct lock *lock UNUSED)
 
 	if (!list_empty(&cond->waiters))
 	{
-		list_sort(&cond->waiters, compare_semaphore_priority, NULL);
-		sema_up(&list_entry(list_pop_front(&cond->waiters),
-							struct semaphore_elem, elem)
-					 ->semaphore);
+		struct list_elem *e = list_max(&cond->waiters, semaphore_elem_less, NULL);
+		list_remove(e);
+		sema_up(&list_entry(e, struct semaphore_elem, elem)->semaphore);
 	}
 }
 
@@ -349,14 +387,317 @@ void cond_broadcast(struct condition *cond, struct lock *lock)
 		cond_signal(cond, lock);
 }
 
+/* A thread sleeping on a wait queue. */
+struct wait_queue_entry
+{
+	struct rb_elem elem;	/* Element in one of the queue's trees. */
+	struct thread *thread;	/* Sleeping thread. */
+	int priority;			/* THREAD's priority when it went to sleep. */
+};
+
+static bool wait_entry_less(const struct rb_elem *, const struct rb_elem *, void *aux);
+static int wait_queue_wake_tree(struct rb_tree *, int nr);
+static void rw_wake(struct rwlock *);
+
+/* Initializes wait queue WQ as empty. */
+void wait_queue_init(struct wait_queue *wq)
+{
+	ASSERT(wq != NULL);
+
+	rb_init(&wq->shared);
+	rb_init(&wq->exclusive);
+}
+
+/* Puts the running thread to sleep on WQ until a wait_queue_wake()
+   picks it, as an exclusive waiter if EXCLUSIVE is true.
+
+   Interrupts must be off, so that the caller's test of the
+   condition it waits for and its going to sleep are atomic with
+   respect to the thread that makes the condition true.  They are
+   still off when this function returns.  This function sleeps, so
+   it must not be called within an interrupt handler. */
+void wait_queue_sleep(struct wait_queue *wq, bool exclusive)
+{
+	struct wait_queue_entry entry;
+
+	ASSERT(wq != NULL);
+	ASSERT(!intr_context());
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	entry.thread = thread_current();
+	entry.priority = entry.thread->priority;
+	rb_insert(exclusive ? &wq->exclusive : &wq->shared, &entry.elem,
+			  wait_entry_less, NULL);
+	thread_block();
+}
+
+/* Wakes every non-exclusive waiter on WQ and up to NR_EXCLUSIVE
+   exclusive ones, highest priority first.  Returns the number of
+   threads woken.
+
+   Does not yield to a woken thread of higher priority; the caller
+   may call thread_preemption() once it is done.  This function
+   may be called from an interrupt handler. */
+int wait_queue_wake(struct wait_queue *wq, int nr_exclusive)
+{
+	enum intr_level old_level;
+	int woken;
+
+	ASSERT(wq != NULL);
+	ASSERT(nr_exclusive >= 0);
+
+	old_level = intr_disable();
+	woken = wait_queue_wake_tree(&wq->shared, INT_MAX);
+	woken += wait_queue_wake_tree(&wq->exclusive, nr_exclusive);
+	intr_set_level(old_level);
+
+	return woken;
+}
+
+/* Returns true if no thread sleeps on WQ. */
+bool wait_queue_empty(const struct wait_queue *wq)
+{
+	ASSERT(wq != NULL);
+
+	return rb_empty(&wq->shared) && rb_empty(&wq->exclusive);
+}
+
+/* Returns the highest priority among WQ's waiters, or PRI_MIN - 1
+   if it has none. */
+int wait_queue_top_priority(const struct wait_queue *wq)
+{
+	struct rb_elem *s = rb_min(&wq->shared);
+	struct rb_elem *x = rb_min(&wq->exclusive);
+	int top = PRI_MIN - 1;
+
+	if (s != NULL)
+		top = rb_entry(s, struct wait_queue_entry, elem)->priority;
+	if (x != NULL && rb_entry(x, struct wait_queue_entry, elem)->priority > top)
+		top = rb_entry(x, struct wait_queue_entry, elem)->priority;
+	return top;
+}
+
+/* Wakes up to NR waiters from TREE, highest priority first, and
+   returns how many it woke.  Interrupts must be off. */
+static int
+wait_queue_wake_tree(struct rb_tree *tree, int nr)
+{
+	int woken = 0;
+
+	while (woken < nr && !rb_empty(tree))
+	{
+		struct wait_queue_entry *entry = rb_entry(rb_min(tree), struct wait_queue_entry, elem);
+
+		rb_remove(tree, &entry->elem);
+		thread_unblock(entry->thread);
+		woken++;
+	}
+	return woken;
+}
+
+/* Initializes RW as an unheld reader-writer lock.
+
+   Ownership is handed over on release: the releasing thread
+   counts woken readers in, or reserves the lock for the woken
+   writer, before they run.  A thread that arrives in between thus
+   cannot slip in ahead of them, which is what keeps a writer from
+   being overtaken again and again. */
+void rw_init(struct rwlock *rw)
+{
+	ASSERT(rw != NULL);
+
+	rw->readers = 0;
+	rw->writer = NULL;
+	rw->handoff = false;
+	wait_queue_init(&rw->read_waiters);
+	wait_queue_init(&rw->write_waiters);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or is
+   waiting for it at a priority no lower than ours.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rw_read_acquire(struct rwlock *rw)
+{
+	enum intr_level old_level;
+
+	ASSERT(rw != NULL);
+	ASSERT(!intr_context());
+	ASSERT(!rw_write_held_by_current_thread(rw));
+
+	old_level = intr_disable();
+	if (rw->writer != NULL || rw->handoff
+		|| wait_queue_top_priority(&rw->write_waiters) >= thread_get_priority())
+		wait_queue_sleep(&rw->read_waiters, false); /* rw_wake() counts us in. */
+	else
+		rw->readers++;
+	intr_set_level(old_level);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void rw_read_release(struct rwlock *rw)
+{
+	enum intr_level old_level;
+
+	ASSERT(rw != NULL);
+	ASSERT(rw->readers > 0);
+
+	old_level = intr_disable();
+	if (--rw->readers == 0)
+		rw_wake(rw);
+	intr_set_level(old_level);
+	thread_preemption();
+}
+
+/* Acquires RW for writing, sleeping until no reader or other
+   writer holds it and no writer of higher priority waits.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rw_write_acquire(struct rwlock *rw)
+{
+	enum intr_level old_level;
+
+	ASSERT(rw != NULL);
+	ASSERT(!intr_context());
+	ASSERT(!rw_write_held_by_current_thread(rw));
+
+	old_level = intr_disable();
+	if (rw->writer != NULL || rw->readers > 0 || rw->handoff
+		|| !wait_queue_empty(&rw->write_waiters))
+	{
+		wait_queue_sleep(&rw->write_waiters, true);
+		ASSERT(rw->handoff);
+		rw->handoff = false;
+	}
+	rw->writer = thread_current();
+	intr_set_level(old_level);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void rw_write_release(struct rwlock *rw)
+{
+	enum intr_level old_level;
+
+	ASSERT(rw != NULL);
+	ASSERT(rw_write_held_by_current_thread(rw));
+
+	old_level = intr_disable();
+	rw->writer = NULL;
+	rw_wake(rw);
+	intr_set_level(old_level);
+	thread_preemption();
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool rw_write_held_by_current_thread(const struct rwlock *rw)
+{
+	ASSERT(rw != NULL);
+
+	return rw->writer == thread_current();
+}
+
+/* Passes RW, which has just become free, to its waiters: to the
+   top waiting writer if no waiting reader outranks it, otherwise
+   to every waiting reader.  Interrupts must be off. */
+static void
+rw_wake(struct rwlock *rw)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(rw->writer == NULL && rw->readers == 0);
+
+	if (!wait_queue_empty(&rw->write_waiters)
+		&& wait_queue_top_priority(&rw->write_waiters)
+			   >= wait_queue_top_priority(&rw->read_waiters))
+	{
+		rw->handoff = true;
+		wait_queue_wake(&rw->write_waiters, 1);
+	}
+	else
+		rw->readers += wait_queue_wake(&rw->read_waiters, 0);
+}
+
 // -----create----- //
 
-bool compare_semaphore_priority(const struct list_elem *a, const struct list_elem *b, void *aux)
+/* Orders a semaphore's waiters by descending priority.  Equal
+   priorities keep their arrival order (see rbtree.h). */
+static bool
+waiter_less(const struct rb_elem *a_, const struct rb_elem *b_, void *aux UNUSED)
+{
+	const struct thread *a = rb_entry(a_, struct thread, wait_elem);
+	const struct thread *b = rb_entry(b_, struct thread, wait_elem);
+	return a->priority > b->priority;
+}
+
+/* Orders a thread's held locks by descending donation, so the
+   lock with the highest-priority waiter is first. */
+static bool
+held_lock_less(const struct rb_elem *a_, const struct rb_elem *b_, void *aux UNUSED)
+{
+	const struct lock *a = rb_entry(a_, struct lock, held_elem);
+	const struct lock *b = rb_entry(b_, struct lock, held_elem);
+	return a->donation > b->donation;
+}
+
+/* Orders a wait queue's entries by descending priority. */
+static bool
+wait_entry_less(const struct rb_elem *a_, const struct rb_elem *b_, void *aux UNUSED)
+{
+	const struct wait_queue_entry *a = rb_entry(a_, struct wait_queue_entry, elem);
+	const struct wait_queue_entry *b = rb_entry(b_, struct wait_queue_entry, elem);
+	return a->priority > b->priority;
+}
+
+/* Orders condition variable waiters by the priority of the thread
+   waiting on each, for list_max(), which returns the earliest of
+   equal maxima. */
+static bool
+semaphore_elem_less(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
 {
 	struct semaphore_elem *sa = list_entry(a, struct semaphore_elem, elem);
 	struct semaphore_elem *sb = list_entry(b, struct semaphore_elem, elem);
+	return sa->thread->priority < sb->thread->priority;
+}
+
+/* Moves T, which waits on SEMA, to its place for its new priority.
+   Interrupts must be off. */
+void sema_requeue(struct semaphore *sema, struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(t->wait_sema == sema);
+
+	rb_remove(&sema->waiters, &t->wait_elem);
+	rb_insert(&sema->waiters, &t->wait_elem, waiter_less, NULL);
+}
 
-	struct list_elem *ta = list_begin(&sa->semaphore.waiters);
-	struct list_elem *tb = list_begin(&sb->semaphore.waiters);
-	return compare_thread_priority(ta, tb, NULL);
-}
\ No newline at end of file
+/* Recomputes the donation of held LOCK from its top waiter and,
+   if it changed, moves LOCK to its new place among its holder's
+   held locks.  Returns true if the donation changed.  Interrupts
+   must be off. */
+bool lock_update_donation(struct lock *lock)
+{
+	struct thread *holder = lock->holder;
+	int donation = PRI_MIN - 1;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(holder != NULL);
+
+	if (!rb_empty(&lock->semaphore.waiters))
+		donation = rb_entry(rb_min(&lock->semaphore.waiters), struct thread, wait_elem)->priority;
+	if (donation == lock->donation)
+		return false;
+
+	rb_remove(&holder->held_locks, &lock->held_elem);
+	lock->donation = donation;
+	rb_insert(&holder->held_locks, &lock->held_elem, held_lock_less, NULL);
+	return true;
+}
+
+/* Returns the highest donation among HELD_LOCKS, a thread's held
+   locks, or PRI_MIN - 1 if no lock has a waiter. */
+int lock_top_donation(struct rb_tree *held_locks)
+{
+	struct rb_elem *top = rb_min(held_locks);
+	return top != NULL ? rb_entry(top, struct lock, held_elem)->donation : PRI_MIN - 1;
+}
@@ -8,9 +8,13 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "threads/fixed_point.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 
 #include "threads/malloc.h"
@@ -27,15 +31,33 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-extern int64_t MIN_alarm_time;
-
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-/* List of processes in THREAD_BLOCKED state, that is, processes
-   that are Waiting for an event to trigger. */
-static struct list sleep_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level, and bit N of `mask'
+   is set whenever queues[N] is nonempty, so the highest-priority
+   ready thread is found with a single bit scan instead of keeping
+   one sorted list. */
+struct runqueue
+{
+	struct list queues[PRI_MAX + 1]; /* One FIFO list per priority. */
+	uint64_t mask;					 /* Nonempty members of queues. */
+	int cnt;						 /* # of threads in queues. */
+	int exempt_cnt;					 /* # of those exempt from MLFQS. */
+
+	/* With -cfs, ready threads are kept in a tree ordered by
+	   vruntime instead, and `queues' and `mask' are unused. */
+	struct rb_tree cfs_tree;		 /* Ready threads by vruntime. */
+	int64_t min_vruntime;			 /* Monotonic floor of vruntimes. */
+	long cfs_load;					 /* Sum of ready threads' weights. */
+
+	/* Ready deadline threads, which run before all of the above
+	   whatever the scheduler.  Not counted in `cnt'. */
+	struct rb_tree dl_tree;			 /* By absolute deadline. */
+};
+
+/* The run queue.  Application processors brought online by smp.c
+   park without scheduling threads, so there is only one. */
+static struct runqueue ready_rq;
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -49,6 +71,16 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* Pages of dead threads, kept for thread_create() to reuse
+   instead of going back to the page allocator.  A recycled page
+   needs no zeroing: init_thread() clears struct thread, and the
+   rest of the page is stack. */
+static struct list thread_page_cache;
+static size_t thread_page_cache_cnt;
+
+/* Maximum number of pages kept in thread_page_cache. */
+size_t thread_page_cache_max = 16;
+
 /* Statistics. */
 static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
@@ -66,11 +98,87 @@ static int pri_run;
 static struct list all_list;
 int load_avg;
 
+/* Threads whose recent_cpu changed since their priority was last
+   computed.  Between two decays only the running thread's
+   recent_cpu grows, so this stays a handful of threads and the
+   4-tick priority pass does not have to walk all_list. */
+static struct list mlfqs_dirty_list;
+
+/* Applies the once-per-second recent_cpu decay to every thread,
+   outside the timer interrupt, on system_highpri_wq. */
+static struct work mlfqs_decay_work;
+
+/* Threads decayed with interrupts off at a time.  mlfqs_decay()
+   turns interrupts back on between batches. */
+#define MLFQS_DECAY_BATCH 8
+
+/* Next thread on all_list for the decay pass in progress, if any.
+   thread_exit() moves it past a thread leaving the list. */
+static struct list_elem *mlfqs_decay_next;
+
+/* Threads that MLFQS does not account for.  A thread only becomes
+   exempt while it runs, never while it is queued, which keeps the
+   run queue's exempt_cnt exact. */
+#define mlfqs_exempt(t) ((t) == idle_thread || (t)->kworker)
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* cfs
+
+   Each thread's vruntime advances by CFS_VRUNTIME_TICK scaled by
+   NICE_0_WEIGHT / weight for every tick it runs, and the ready
+   thread with the smallest vruntime runs next, so CPU time is
+   shared in proportion to weight.  A running thread keeps the CPU
+   for its share of CFS_LATENCY, but never less than
+   CFS_MIN_GRANULARITY, before it can be preempted. */
+#define CFS_VRUNTIME_TICK 1024	  /* vruntime units per tick at nice 0. */
+#define CFS_LATENCY 8			  /* Ticks in which all ready threads run. */
+#define CFS_MIN_GRANULARITY 2	  /* Shortest slice, in ticks. */
+#define CFS_WAKEUP_GRANULARITY 1 /* Wakeup preemption margin, in ticks. */
+#define NICE_0_WEIGHT 1024
+
+/* Weight of each nice value from -20 to 20.  Each step is about
+   1.25 times the next, so that one nice level is worth about 10%
+   of the CPU against a thread at the neighbouring level. */
+static const int cfs_weights[41] = {
+	/* -20 */ 88761, 71755, 56483, 46273, 36291,
+	/* -15 */ 29154, 23254, 18705, 14949, 11916,
+	/* -10 */ 9548, 7620, 6100, 4904, 3906,
+	/*  -5 */ 3121, 2501, 1991, 1586, 1277,
+	/*   0 */ 1024, 820, 655, 526, 423,
+	/*   5 */ 335, 272, 215, 172, 137,
+	/*  10 */ 110, 87, 70, 56, 45,
+	/*  15 */ 36, 29, 23, 18, 15,
+	/*  20 */ 12,
+};
+#define cfs_weight(t) (cfs_weights[(t)->nice + 20])
+
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* deadline
+
+   A thread that opts in with thread_set_deadline() gets DL_RUNTIME
+   ticks of CPU time every DL_PERIOD ticks, each batch to be used
+   before DL_DEADLINE ticks into its period.  Ready deadline threads
+   run ahead of every other thread, earliest absolute deadline
+   first.  One that uses up its budget is throttled until its next
+   period, so it cannot take more than it reserved, and admission
+   control keeps the reservations within DL_BW_LIMIT of the CPU,
+   so every admitted thread meets its deadlines.
+
+   Bandwidths are fractions of the CPU in fixed point with
+   DL_BW_SHIFT fraction bits. */
+#define DL_BW_SHIFT 20
+#define DL_BW_LIMIT ((1 << DL_BW_SHIFT) * 95 / 100)
+#define thread_is_dl(t) ((t)->dl_runtime != 0)
+#define dl_bw(t) (thread_is_dl(t) ? ((t)->dl_runtime << DL_BW_SHIFT) / (t)->dl_period : 0)
+static int64_t dl_total_bw;		  /* Sum of admitted bandwidths. */
+
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
@@ -78,7 +186,30 @@ static struct thread *next_thread_to_run(void);
 static void init_thread(struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule(void);
+static void rusage_switch(struct thread *prev, struct thread *next);
 static tid_t allocate_tid(void);
+static struct thread *thread_page_alloc(void);
+static void thread_reap(void);
+static void ready_queue_push(struct runqueue *, struct thread *);
+static void ready_queue_remove(struct runqueue *, struct thread *);
+static int ready_queue_top(const struct runqueue *);
+static void ready_queue_settle(struct runqueue *);
+static void thread_requeue(struct thread *, int priority);
+static void thread_wakeup(void *t_);
+static void mlfqs_decay(struct work *);
+static bool cfs_less(const struct rb_elem *, const struct rb_elem *, void *aux);
+static void cfs_update_min_vruntime(struct runqueue *);
+static struct thread *cfs_first(struct runqueue *);
+static unsigned cfs_slice(struct runqueue *, struct thread *);
+static void cfs_tick(struct thread *);
+static void cfs_place(struct runqueue *, struct thread *);
+static void cfs_preemption(void);
+static bool dl_less(const struct rb_elem *, const struct rb_elem *, void *aux);
+static bool dl_preempts(struct runqueue *, struct thread *);
+static bool wakeup_preempts(struct runqueue *, struct thread *cur, struct thread *t);
+static void dl_tick(struct thread *);
+static void dl_wakeup(struct thread *);
+static void dl_replenish(void *t_);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -111,6 +242,7 @@ static uint64_t gdt[3] = {0, 0x00af9a000000ffff, 0x00cf92000000ffff};
 void thread_init(void)
 {
 	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(sizeof(struct thread) <= THREAD_SIZE_MAX);
 
 	/* Reload the temporal gdt for the kernel
 	 * This gdt does not include the user context.
@@ -122,10 +254,20 @@ void thread_init(void)
 
 	/* Init the global thread context */
 	lock_init(&tid_lock);
-	list_init(&ready_list);
-	list_init(&sleep_list);
+	for (int i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init(&ready_rq.queues[i]);
+	ready_rq.mask = 0;
+	ready_rq.cnt = 0;
+	ready_rq.exempt_cnt = 0;
+	rb_init(&ready_rq.cfs_tree);
+	ready_rq.min_vruntime = 0;
+	ready_rq.cfs_load = 0;
+	rb_init(&ready_rq.dl_tree);
 	list_init(&destruction_req);
+	list_init(&thread_page_cache);
 	list_init(&all_list);
+	list_init(&mlfqs_dirty_list);
+	work_init(&mlfqs_decay_work, mlfqs_decay, PRI_MAX);
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread();
@@ -136,7 +278,7 @@ void thread_init(void)
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
-   Also creates the idle thread. */
+   Also creates the idle thread and the system work queues. */
 void thread_start(void)
 {
 	/* Create the idle thread. */
@@ -150,6 +292,10 @@ void thread_start(void)
 
 	/* Wait for the idle thread to initialize idle_thread. */
 	sema_down(&idle_started);
+
+	/* Only now, since a new worker may preempt this thread as soon
+	   as it is created. */
+	workqueue_init();
 }
 
 /* Called by the timer interrupt handler at each timer tick.
@@ -163,16 +309,37 @@ void thread_tick(void)
 		idle_ticks++;
 #ifdef USERPROG
 	else if (t->pml4 != NULL)
+	{
 		user_ticks++;
+		t->rusage.utime++;
+	}
 #endif
 	else
+	{
 		kernel_ticks++;
+		t->rusage.stime++;
+	}
 
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	++thread_ticks;
+	if (thread_is_dl(t))
+		dl_tick(t);
+	else if (thread_cfs)
+	{
+		if (t != idle_thread)
+			cfs_tick(t);
+	}
+	else if (thread_ticks >= TIME_SLICE)
 		intr_yield_on_return();
 }
 
+/* Called by the timer interrupt for each tick that the idle
+   thread slept through while the periodic tick was stopped. */
+void thread_tick_idle(void)
+{
+	idle_ticks++;
+}
+
 /* Prints thread statistics. */
 void thread_print_stats(void)
 {
@@ -198,12 +365,13 @@ void thread_print_stats(void)
 tid_t thread_create(const char *name, int priority, thread_func *function, void *aux)
 {
 	struct thread *t;
+	struct switch_threads_frame *frame;
 	tid_t tid;
 
 	ASSERT(function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page(PAL_ZERO);
+	t = thread_page_alloc();
 	if (t == NULL)
 		return TID_ERROR;
 
@@ -211,16 +379,21 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 	init_thread(t, name, priority);
 	tid = t->tid = allocate_tid();
 
-	/* Call the kernel_thread if it scheduled.
-	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
-	t->tf.rip = (uintptr_t)kernel_thread;
-	t->tf.R.rdi = (uint64_t)function;
-	t->tf.R.rsi = (uint64_t)aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+	/* Make the first switch to T "return" into switch_entry(),
+	 * which calls kernel_thread(FUNCTION, AUX).  The frame leaves
+	 * the stack 16-byte aligned at that call, as the ABI expects. */
+	frame = (struct switch_threads_frame *)((uint8_t *)t + PGSIZE - 16) - 1;
+	memset(frame, 0, sizeof *frame);
+	frame->rbx = (uint64_t)kernel_thread;
+	frame->r12 = (uint64_t)function;
+	frame->r13 = (uint64_t)aux;
+	frame->rip = switch_entry;
+	t->rsp = (uint64_t)frame;
+
+	/* A new thread starts level with the threads already ready,
+	   rather than with a vruntime of 0 that would let it
+	   monopolize the CPU. */
+	t->vruntime = ready_rq.min_vruntime;
 
 	list_push_back(&all_list, &t->allelem);
 
@@ -234,12 +407,9 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 	/* 자식 리스트에 추가 */
 	list_push_back(&thread_current()->children_list, &t->child_elem);
 
-	// * 파일 디스크립터 초기값 설정
-	t->fdt = palloc_get_page(PAL_ZERO);
-	if (t->fdt == NULL)  return TID_ERROR;
-
-	t->fdt[0] = 1;
-	t->fdt[1] = 2;
+	/* The file descriptor table is allocated by process_fdt() on
+	   first use. */
+	t->fdt = NULL;
 	t->next_fd = 2;
 
 	/* ------------ USERPROG ------------ */
@@ -262,6 +432,8 @@ void thread_block(void)
 {
 	ASSERT(!intr_context());
 	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(thread_current()->preempt_count == 0);
+	trace_record(TRACE_BLOCK, thread_current(), 0);
 	thread_current()->status = THREAD_BLOCKED;
 	schedule();
 }
@@ -283,8 +455,16 @@ void thread_unblock(struct thread *t)
 
 	old_level = intr_disable();
 	ASSERT(t->status == THREAD_BLOCKED);
-	list_insert_ordered(&ready_list, &t->elem, compare_thread_priority, NULL);
+	if (thread_is_dl(t))
+		dl_wakeup(t);
+	else if (thread_cfs)
+		cfs_place(&ready_rq, t);
+	ready_queue_push(&ready_rq, t);
+	if (intr_context() && wakeup_preempts(&ready_rq, running_thread(), t))
+		intr_yield_on_return();
 	t->status = THREAD_READY;
+	t->ready_since = timer_ticks();
+	trace_record(TRACE_UNBLOCK, t, 0);
 	intr_set_level(old_level);
 }
 
@@ -329,11 +509,18 @@ void thread_exit(void)
 #ifdef USERPROG
 	process_exit();
 #endif
-	list_remove(&thread_current()->allelem);
+	if (thread_is_dl(thread_current()))
+		thread_set_deadline(0, 0, 0); /* Give back its bandwidth. */
+	malloc_cache_flush();
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable();
+	if (mlfqs_decay_next == &thread_current()->allelem)
+		mlfqs_decay_next = list_next(mlfqs_decay_next);
+	list_remove(&thread_current()->allelem);
+	if (thread_current()->mlfqs_dirty)
+		list_remove(&thread_current()->mlfqs_elem);
 	do_schedule(THREAD_DYING);
 	NOT_REACHED();
 }
@@ -350,20 +537,21 @@ void thread_yield(void)
 
 	old_level = intr_disable();
 	if (curr != idle_thread)
-		list_insert_ordered(&ready_list, &curr->elem, compare_thread_priority, NULL);
+		ready_queue_push(&ready_rq, curr);
 	do_schedule(THREAD_READY);
 	intr_set_level(old_level);
 }
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void thread_set_priority(int new_priority)
 {
-	if (thread_mlfqs) return;
+	if (thread_mlfqs || thread_cfs) return;
 
-	thread_current()->priority = new_priority;
+	enum intr_level old_level = intr_disable();
 	thread_current()->init_priority = new_priority;
 
 	/* donation */
-	refresh_priority();
+	refresh_priority(thread_current());
+	intr_set_level(old_level);
 	/* prirority */
 	thread_preemption();
 }
@@ -381,7 +569,8 @@ void thread_set_nice(int nice UNUSED)
 
 	old_level = intr_disable();
 	t->nice = nice;
-	mlfqs_priority(t);
+	if (!thread_cfs)
+		mlfqs_priority(t);
 	thread_preemption();
 	intr_set_level(old_level);
 }
@@ -441,8 +630,23 @@ idle(void *idle_started_ UNUSED)
 	{
 		/* Let someone else run. */
 		intr_disable();
+		timer_idle_exit();
 		thread_block();
 
+		/* Nothing else is runnable.  Zero a page for PAL_ZERO
+		   requests, then let pending interrupts in and look for
+		   another thread to run before the next one, so that the
+		   zeroing only ever uses time no thread wants. */
+		if (palloc_zero_idle())
+		{
+			intr_enable();
+			continue;
+		}
+
+		/* Nothing else is runnable: in tickless mode, stop the
+		   periodic tick until the next timeout is due. */
+		timer_idle_enter();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -459,6 +663,15 @@ idle(void *idle_started_ UNUSED)
 					 :
 					 :
 					 : "memory");
+
+		/* Woken with nothing to run, typically by the tick's own
+		   chained one-shot: keep halting without rescheduling. */
+		intr_disable();
+		while (ready_rq.cnt == 0 && rb_empty(&ready_rq.dl_tree) && timer_idle_resume())
+			asm volatile("sti; hlt"
+						 :
+						 :
+						 : "memory");
 	}
 }
 
@@ -485,14 +698,13 @@ init_thread(struct thread *t, const char *name, int priority)
 	memset(t, 0, sizeof *t);
 	t->status = THREAD_BLOCKED;
 	strlcpy(t->name, name, sizeof t->name);
-	t->tf.rsp = (uint64_t)t + PGSIZE - sizeof(void *);
 	t->priority = priority;
 	t->magic = THREAD_MAGIC;
 
 	/* Priority donation관련 자료구조 초기화 */
 	t->init_priority = priority;
 	t->wait_on_lock = NULL;
-	list_init(&t->donations);
+	rb_init(&t->held_locks);
 
 	/* MLFQ 자료구조 초기화 */
 	t->nice = NICE_DEFAULT;
@@ -500,6 +712,9 @@ init_thread(struct thread *t, const char *name, int priority)
 
 	/* USERPROG */
 	list_init(&t->children_list);
+
+	timeout_init(&t->wakeup, thread_wakeup, t);
+	timeout_init(&t->dl_timer, dl_replenish, t);
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
@@ -510,13 +725,151 @@ init_thread(struct thread *t, const char *name, int priority)
 static struct thread *
 next_thread_to_run(void)
 {
-	if (list_empty(&ready_list))
-		return idle_thread;
+	struct runqueue *rq = &ready_rq;
+	struct thread *t = idle_thread;
+
+	if (!rb_empty(&rq->dl_tree))
+	{
+		t = rb_entry(rb_min(&rq->dl_tree), struct thread, dl_elem);
+		ready_queue_remove(rq, t);
+	}
+	else if (thread_cfs)
+	{
+		if (rq->cnt != 0)
+		{
+			t = cfs_first(rq);
+			ready_queue_remove(rq, t);
+			cfs_update_min_vruntime(rq);
+		}
+	}
 	else
-		return list_entry(list_pop_front(&ready_list), struct thread, elem);
+	{
+		ready_queue_settle(rq);
+		if (rq->mask != 0)
+		{
+			t = list_entry(list_front(&rq->queues[ready_queue_top(rq)]), struct thread, elem);
+			ready_queue_remove(rq, t);
+		}
+	}
+	return t;
 }
 
-/* Use iretq to launch the thread */
+/* Appends T to RQ's list for its current priority.
+   Interrupts must be off. */
+static void
+ready_queue_push(struct runqueue *rq, struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (thread_is_dl(t))
+	{
+		/* A throttled thread waits for dl_replenish() instead. */
+		if (!t->dl_throttled)
+			rb_insert(&rq->dl_tree, &t->dl_elem, dl_less, NULL);
+		return;
+	}
+	rq->cnt++;
+	if (mlfqs_exempt(t))
+		rq->exempt_cnt++;
+	if (thread_cfs)
+	{
+		rb_insert(&rq->cfs_tree, &t->cfs_elem, cfs_less, NULL);
+		rq->cfs_load += cfs_weight(t);
+		return;
+	}
+	t->queued_priority = t->priority;
+	list_push_back(&rq->queues[t->priority], &t->elem);
+	rq->mask |= (uint64_t)1 << t->priority;
+}
+
+/* Removes T from the RQ list it was pushed onto.
+   Interrupts must be off. */
+static void
+ready_queue_remove(struct runqueue *rq, struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (thread_is_dl(t))
+	{
+		if (!t->dl_throttled)
+			rb_remove(&rq->dl_tree, &t->dl_elem);
+		return;
+	}
+	rq->cnt--;
+	if (mlfqs_exempt(t))
+		rq->exempt_cnt--;
+	if (thread_cfs)
+	{
+		rb_remove(&rq->cfs_tree, &t->cfs_elem);
+		rq->cfs_load -= cfs_weight(t);
+		return;
+	}
+	list_remove(&t->elem);
+	if (list_empty(&rq->queues[t->queued_priority]))
+		rq->mask &= ~((uint64_t)1 << t->queued_priority);
+}
+
+/* Moves threads whose priority dropped while they were queued
+   (see thread_requeue()) down to the list for their priority,
+   until the front of the highest nonempty list is up to date.
+   No thread is ever queued below its priority, so afterward
+   ready_queue_top() is exact.  Interrupts must be off. */
+static void
+ready_queue_settle(struct runqueue *rq)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	while (rq->mask != 0)
+	{
+		struct thread *t = list_entry(list_front(&rq->queues[ready_queue_top(rq)]), struct thread, elem);
+		if (t->priority == t->queued_priority)
+			break;
+		ready_queue_remove(rq, t);
+		ready_queue_push(rq, t);
+	}
+}
+
+/* Returns the highest priority that has a ready thread in RQ, or
+   -1 if RQ is empty. */
+static int
+ready_queue_top(const struct runqueue *rq)
+{
+	uint64_t mask = rq->mask;
+	return mask != 0 ? 63 - __builtin_clzll(mask) : -1;
+}
+
+/* Sets T's priority to PRIORITY.  If T is blocked on a
+   semaphore, it is moved to its new place among the waiters.  If
+   T is sitting in the run queue and PRIORITY is higher than the
+   list it is on, it is moved to the tail of the new priority's
+   list right away.  A lower priority is only recorded;
+   ready_queue_settle() moves the thread down once it reaches the
+   front of the highest list, so the once-per-second MLFQS pass
+   over every thread does not shuffle the run queue. */
+static void
+thread_requeue(struct thread *t, int priority)
+{
+	enum intr_level old_level;
+
+	old_level = intr_disable();
+	if (t->status == THREAD_READY && priority > t->queued_priority && !thread_cfs && !thread_is_dl(t))
+	{
+		ready_queue_remove(&ready_rq, t);
+		t->priority = priority;
+		ready_queue_push(&ready_rq, t);
+	}
+	else if (t->status == THREAD_BLOCKED && t->wait_sema != NULL && t->priority != priority)
+	{
+		t->priority = priority;
+		sema_requeue(t->wait_sema, t);
+	}
+	else
+		t->priority = priority;
+	intr_set_level(old_level);
+}
+
+/* Restores the context in TF with iretq.  Kernel threads switch
+   with switch_threads(); this is for entering user mode. */
 void do_iret(struct intr_frame *tf)
 {
 	__asm __volatile(
@@ -546,75 +899,17 @@ void do_iret(struct intr_frame *tf)
 		: "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
-
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
+/* Switches from the running thread to TH, which resumes where
+   it last called this function, or in switch_entry() if it is
+   new.  Returns when the running thread is next scheduled.
 
-   It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. */
+   Interrupts must be off. */
 static void
 thread_launch(struct thread *th)
 {
-	uint64_t tf_cur = (uint64_t)&running_thread()->tf;
-	uint64_t tf = (uint64_t)&th->tf;
 	ASSERT(intr_get_level() == INTR_OFF);
 
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile(
-		/* Store registers that will be used. */
-		"push %%rax\n"
-		"push %%rbx\n"
-		"push %%rcx\n"
-		/* Fetch input once */
-		"movq %0, %%rax\n"
-		"movq %1, %%rcx\n"
-		"movq %%r15, 0(%%rax)\n"
-		"movq %%r14, 8(%%rax)\n"
-		"movq %%r13, 16(%%rax)\n"
-		"movq %%r12, 24(%%rax)\n"
-		"movq %%r11, 32(%%rax)\n"
-		"movq %%r10, 40(%%rax)\n"
-		"movq %%r9, 48(%%rax)\n"
-		"movq %%r8, 56(%%rax)\n"
-		"movq %%rsi, 64(%%rax)\n"
-		"movq %%rdi, 72(%%rax)\n"
-		"movq %%rbp, 80(%%rax)\n"
-		"movq %%rdx, 88(%%rax)\n"
-		"pop %%rbx\n" // Saved rcx
-		"movq %%rbx, 96(%%rax)\n"
-		"pop %%rbx\n" // Saved rbx
-		"movq %%rbx, 104(%%rax)\n"
-		"pop %%rbx\n" // Saved rax
-		"movq %%rbx, 112(%%rax)\n"
-		"addq $120, %%rax\n"
-		"movw %%es, (%%rax)\n"
-		"movw %%ds, 8(%%rax)\n"
-		"addq $32, %%rax\n"
-		"call __next\n" // read the current rip.
-		"__next:\n"
-		"pop %%rbx\n"
-		"addq $(out_iret -  __next), %%rbx\n"
-		"movq %%rbx, 0(%%rax)\n" // rip
-		"movw %%cs, 8(%%rax)\n"	 // cs
-		"pushfq\n"
-		"popq %%rbx\n"
-		"mov %%rbx, 16(%%rax)\n" // eflags
-		"mov %%rsp, 24(%%rax)\n" // rsp
-		"movw %%ss, 32(%%rax)\n"
-		"mov %%rcx, %%rdi\n"
-		"call do_iret\n"
-		"out_iret:\n"
-		:
-		: "g"(tf_cur), "g"(tf)
-		: "memory");
+	switch_threads(&running_thread()->rsp, th->rsp);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -626,12 +921,7 @@ do_schedule(int status)
 {
 	ASSERT(intr_get_level() == INTR_OFF);
 	ASSERT(thread_current()->status == THREAD_RUNNING);
-	while (!list_empty(&destruction_req))
-	{
-		struct thread *victim =
-			list_entry(list_pop_front(&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
-	}
+	thread_reap();
 	thread_current()->status = status;
 	schedule();
 }
@@ -650,6 +940,7 @@ schedule(void)
 
 	/* Start new time slice. */
 	thread_ticks = 0;
+	curr->need_resched = false;
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -673,10 +964,57 @@ schedule(void)
 
 		/* Before switching the thread, we first save the information
 		 * of current running. */
+		rusage_switch(curr, next);
+		trace_record(TRACE_SWITCH, next, curr->tid);
 		thread_launch(next);
 	}
 }
 
+/* Returns an uninitialized page for a new thread, preferably a
+   cached page of a thread that has died.  Returns a null pointer
+   if no page is available. */
+static struct thread *
+thread_page_alloc(void)
+{
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable();
+	thread_reap();
+	if (!list_empty(&thread_page_cache))
+	{
+		t = list_entry(list_pop_front(&thread_page_cache), struct thread, elem);
+		thread_page_cache_cnt--;
+	}
+	intr_set_level(old_level);
+
+	return t != NULL ? t : palloc_get_page(0);
+}
+
+/* Disposes of the threads on destruction_req, which have all
+   switched away for the last time.  Their pages go to the thread
+   page cache while it has room and back to the page allocator
+   otherwise.  Interrupts must be off. */
+static void
+thread_reap(void)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	while (!list_empty(&destruction_req))
+	{
+		struct thread *victim =
+			list_entry(list_pop_front(&destruction_req), struct thread, elem);
+		if (thread_page_cache_cnt < thread_page_cache_max)
+		{
+			victim->magic = 0;
+			list_push_front(&thread_page_cache, &victim->elem);
+			thread_page_cache_cnt++;
+		}
+		else
+			palloc_free_page(victim);
+	}
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid(void)
@@ -693,6 +1031,9 @@ allocate_tid(void)
 
 // -----create----- //
 
+/* Blocks the running thread until timer tick TICKS.  The wakeup
+   is a kernel timeout on the timer wheel, so the timer interrupt
+   never has to look at threads that are still asleep. */
 void thread_sleep(int64_t ticks)
 {
 	enum intr_level old_level;
@@ -700,114 +1041,168 @@ void thread_sleep(int64_t ticks)
 
 	old_level = intr_disable();
 	if (cur_thread != idle_thread)
-	{
-		cur_thread->time_to_wakeup = ticks;
-
-		if (MIN_alarm_time > ticks)
-		{
-			MIN_alarm_time = ticks;
-		}
-
-		list_push_back(&sleep_list, &cur_thread->elem);
-	}
+		timeout_add(&cur_thread->wakeup, ticks);
+	trace_record(TRACE_SLEEP, cur_thread, ticks);
 
 	do_schedule(THREAD_BLOCKED);
 	intr_set_level(old_level);
 }
 
-void thread_awake(int64_t ticks) 
+/* Timeout callback that readies the sleeping thread T_. */
+static void
+thread_wakeup(void *t_)
 {
-	struct thread *sleep_thread;
-	struct list_elem *now = list_begin(&sleep_list);
-	int64_t new_MIN = INT64_MAX;
+	trace_record(TRACE_WAKE, (struct thread *)t_, 0);
+	thread_unblock(t_);
+}
+
+void thread_preemption(void)
+{
+	struct runqueue *rq = &ready_rq;
+	enum intr_level old_level;
+	bool dl;
+	int top;
 
-	while (now != list_tail(&sleep_list))
+	if (intr_context())
+		return;
+	if (!preemptible())
 	{
-		sleep_thread = list_entry(now, struct thread, elem);
+		thread_current()->need_resched = true;
+		return;
+	}
 
-		if (sleep_thread->time_to_wakeup <= ticks)
-		{
-			now = list_remove(&sleep_thread->elem);
-			thread_unblock(sleep_thread);
-		}
-		else
-		{
-			now = list_next(now);
-			if (new_MIN > sleep_thread->time_to_wakeup)
-				new_MIN = sleep_thread->time_to_wakeup;
-		}
+	old_level = intr_disable();
+	dl = dl_preempts(rq, thread_current());
+	intr_set_level(old_level);
+	if (dl)
+	{
+		thread_yield();
+		return;
 	}
-	MIN_alarm_time = new_MIN;
-}
 
-void thread_preemption(void)
-{
-	if (!list_empty(&ready_list) && !intr_context())
+	/* Nothing in the other classes preempts a deadline thread. */
+	if (thread_is_dl(thread_current()))
+		return;
+
+	if (thread_cfs)
 	{
-		struct thread *top_pri = list_begin(&ready_list);
-		if (compare_thread_priority(top_pri, &thread_current()->elem, NULL))
-			thread_yield();
+		cfs_preemption();
+		return;
 	}
+
+	old_level = intr_disable();
+	ready_queue_settle(rq);
+	top = ready_queue_top(rq);
+	intr_set_level(old_level);
+
+	if (top > thread_current()->priority)
+		thread_yield();
 }
 
-bool compare_thread_priority(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED)
+/* Disables preemption of the running thread, nesting.  Until the
+   matching preempt_enable(), interrupts and wakeups that would
+   switch it out only mark the switch as due.  The thread must not
+   sleep meanwhile. */
+void preempt_disable(void)
 {
-	struct thread *a = list_entry(a_, struct thread, elem);
-	struct thread *b = list_entry(b_, struct thread, elem);
-	return a->priority > b->priority; 
+	thread_current()->preempt_count++;
+	barrier();
 }
 
+/* Undoes one preempt_disable().  If that re-enables preemption
+   and a switch became due meanwhile, yields now, unless interrupts
+   are off, in which case the switch waits for the next
+   preemption point. */
+void preempt_enable(void)
+{
+	struct thread *cur = thread_current();
 
-bool compare_donation_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
+	barrier();
+	ASSERT(cur->preempt_count > 0);
+	if (--cur->preempt_count == 0 && cur->need_resched
+		&& !intr_context() && intr_get_level() == INTR_ON)
+	{
+		cur->need_resched = false;
+		thread_yield();
+	}
+}
+
+/* Returns true if the running thread may be switched out by an
+   interrupt or a wakeup. */
+bool preemptible(void)
 {
-	struct thread *da = list_entry(a, struct thread, donation_elem);
-	struct thread *db = list_entry(b, struct thread, donation_elem);
-	return da->priority > db->priority;
+	return running_thread()->preempt_count == 0;
 }
 
-void donate_priority(void)
+/* Called on return from an external interrupt whose handler asked
+   to yield.  Yields unless the interrupted thread has preemption
+   disabled, in which case its preempt_enable() yields instead. */
+void preempt_schedule_irq(void)
 {
-	struct thread *holder = thread_current()->wait_on_lock->holder;
-	int count = 0;
-	while (holder != NULL)
-	{
-		holder->priority = thread_current()->priority;
-		count++;
-		if (count > 8 || holder->wait_on_lock == NULL)
-			break;
-		holder = holder->wait_on_lock->holder;
-	}
+	ASSERT(!intr_context());
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (preemptible())
+		thread_yield();
+	else
+		thread_current()->need_resched = true;
 }
 
-void remove_with_lock(struct lock *lock)
+/* Called by sema_down() when the running thread is about to block
+   on its wait_on_lock: the lock's donation may have risen, and
+   with it the holder's priority.  Interrupts must be off. */
+void donate_priority(void)
 {
-	struct list_elem *curr_donation_elem = list_begin(&thread_current()->donations);
+	struct lock *lock = thread_current()->wait_on_lock;
+
+	ASSERT(intr_get_level() == INTR_OFF);
 
-	while (curr_donation_elem != list_tail(&thread_current()->donations))
+	if (thread_mlfqs || thread_cfs)
+		return;
+	if (lock_update_donation(lock))
 	{
-		struct thread *curr_donation_thread = list_entry(curr_donation_elem, struct thread, donation_elem);
-		if (curr_donation_thread->wait_on_lock == lock)
-			curr_donation_elem = list_remove(curr_donation_elem);
-		else
-			curr_donation_elem = list_next(curr_donation_elem);
+		trace_record(TRACE_DONATE, thread_current(), lock->holder->tid);
+		refresh_priority(lock->holder);
 	}
 }
 
-void refresh_priority(void)
+/* Recomputes T's priority as the larger of its own priority and
+   the top donation among the locks it holds.  A change is passed
+   on to the holder of the lock T waits for, and so on down the
+   chain.  Each hop costs O(log n) for the run queue, semaphore and
+   held-lock trees it touches, and propagation stops at the first
+   hop that changes nothing, so the work is bounded by the length
+   of the chain with no fixed cutoff.  Interrupts must be off. */
+void refresh_priority(struct thread *t)
 {
-	thread_current()->priority = thread_current()->init_priority;
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (thread_mlfqs || thread_cfs)
+		return;
 
-	if (!list_empty(&thread_current()->donations))
+	while (t != NULL)
 	{
-		struct thread *front_thread = list_entry(list_begin(&thread_current()->donations), struct thread, donation_elem);
-		if (thread_current()->priority < front_thread->priority)
-			thread_current()->priority = front_thread->priority;
+		int priority = t->init_priority;
+		int donation = lock_top_donation(&t->held_locks);
+		struct lock *lock;
+
+		if (donation > priority)
+			priority = donation;
+		if (priority == t->priority)
+			break;
+
+		thread_requeue(t, priority);
+
+		lock = t->wait_on_lock;
+		if (lock == NULL || lock->holder == NULL || !lock_update_donation(lock))
+			break;
+		t = lock->holder;
 	}
 }
 
 void mlfqs_priority(struct thread *t)
 {
-    if (t != idle_thread) 
+    if (!mlfqs_exempt(t)) 
 	{
         int rec_by_4 = div_complex(t->recent_cpu, 4);
         int nice2 = 2 * t->nice;
@@ -818,13 +1213,13 @@ void mlfqs_priority(struct thread *t)
             pri_result = PRI_MIN;
         if (pri_result > PRI_MAX)
             pri_result = PRI_MAX;
-        t->priority = pri_result;
+        thread_requeue(t, pri_result);
     }
 }
 
 void mlfqs_recent_cpu(struct thread *t)
 {
-    if (t != idle_thread) 
+    if (!mlfqs_exempt(t)) 
 	{
         int load_avg_2 = mult_complex(load_avg, 2);
         int load_avg_2_1 = add_complex(load_avg_2, 1);
@@ -843,34 +1238,357 @@ void mlfqs_load_avg(void)
     int a = fp_div(int_to_fp(59), int_to_fp(60));
     int b = fp_div(int_to_fp(1), int_to_fp(60));
     int load_avg2 = fp_mult(a, load_avg);
-    int ready_thread = (int)list_size(&ready_list);
-    ready_thread = (thread_current() == idle_thread) ? ready_thread : ready_thread + 1;
+    int ready_thread = ready_rq.cnt - ready_rq.exempt_cnt;
+    if (!mlfqs_exempt(thread_current()))
+        ready_thread++;
     int ready_thread2 = mult_complex(b, ready_thread);
     int result = fp_add(load_avg2, ready_thread2);
     load_avg = result;
 }
 
+/* Charges the running thread for the current tick. */
 void mlfqs_increment(void) 
 {
-    if (thread_current() != idle_thread) 
+    struct thread *cur = thread_current();
+
+    if (!mlfqs_exempt(cur)) 
 	{
-        int cur_recent_cpu = thread_current()->recent_cpu;
-        thread_current()->recent_cpu = add_complex(cur_recent_cpu, 1);
+        cur->recent_cpu = add_complex(cur->recent_cpu, 1);
+        if (!cur->mlfqs_dirty)
+        {
+            cur->mlfqs_dirty = true;
+            list_push_back(&mlfqs_dirty_list, &cur->mlfqs_elem);
+        }
     }
 }
 
+/* Called from the timer interrupt once per second.  Decaying
+   every thread's recent_cpu is O(n), so it is queued on
+   system_highpri_wq, whose worker runs as soon as the interrupt
+   returns.  Skipped in the first moments of boot, before
+   thread_start() has created the queue. */
 void mlfqs_recalc_recent_cpu(void) 
 {
-    for (struct list_elem *tmp = list_begin(&all_list); tmp != list_end(&all_list); tmp = list_next(tmp)) 
-	{
-        mlfqs_recent_cpu(list_entry(tmp, struct thread, allelem));
-    }
+    if (system_highpri_wq != NULL)
+        queue_work(system_highpri_wq, &mlfqs_decay_work);
 }
 
+/* Called from the timer interrupt every 4 ticks.  Recomputes the
+   priority of the threads whose recent_cpu grew since the last
+   call; every other thread's priority is already current. */
 void mlfqs_recalc_priority(void) 
 {
-    for (struct list_elem *tmp = list_begin(&all_list); tmp != list_end(&all_list); tmp = list_next(tmp)) 
-	{
-        mlfqs_priority(list_entry(tmp, struct thread, allelem));
+    while (!list_empty(&mlfqs_dirty_list))
+    {
+        struct thread *t = list_entry(list_pop_front(&mlfqs_dirty_list), struct thread, mlfqs_elem);
+        t->mlfqs_dirty = false;
+        mlfqs_priority(t);
     }
-}
\ No newline at end of file
+}
+
+/* Work function for mlfqs_decay_work.  Applies the recent_cpu
+   decay, and the priority change it implies, to every thread, in
+   batches of MLFQS_DECAY_BATCH so that interrupts are never off
+   for a walk of the whole of all_list. */
+static void
+mlfqs_decay(struct work *w UNUSED)
+{
+    enum intr_level old_level;
+    int i;
+
+    old_level = intr_disable();
+    mlfqs_decay_next = list_begin(&all_list);
+    while (mlfqs_decay_next != list_end(&all_list))
+    {
+        for (i = 0; i < MLFQS_DECAY_BATCH && mlfqs_decay_next != list_end(&all_list); i++)
+        {
+            struct thread *t = list_entry(mlfqs_decay_next, struct thread, allelem);
+            mlfqs_decay_next = list_next(mlfqs_decay_next);
+            mlfqs_recent_cpu(t);
+            mlfqs_priority(t);
+        }
+
+        /* Let pending interrupts in. */
+        intr_enable();
+        intr_disable();
+    }
+    mlfqs_decay_next = NULL;
+    intr_set_level(old_level);
+}
+
+/* Orders threads in a CFS run queue by vruntime. */
+static bool
+cfs_less(const struct rb_elem *a_, const struct rb_elem *b_, void *aux UNUSED)
+{
+	const struct thread *a = rb_entry(a_, struct thread, cfs_elem);
+	const struct thread *b = rb_entry(b_, struct thread, cfs_elem);
+	return a->vruntime < b->vruntime;
+}
+
+/* Returns the ready thread in RQ with the smallest vruntime.
+   RQ must not be empty, and interrupts must be off. */
+static struct thread *
+cfs_first(struct runqueue *rq)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	return rb_entry(rb_min(&rq->cfs_tree), struct thread, cfs_elem);
+}
+
+/* Advances RQ's min_vruntime to the smallest vruntime among the
+   running thread and the ready threads, if that is larger.
+   Threads that wake up are placed relative to it.  Interrupts
+   must be off. */
+static void
+cfs_update_min_vruntime(struct runqueue *rq)
+{
+	struct thread *cur = running_thread();
+	int64_t min = INT64_MAX;
+
+	if (cur != idle_thread && cur->status == THREAD_RUNNING)
+		min = cur->vruntime;
+	if (rq->cnt != 0 && cfs_first(rq)->vruntime < min)
+		min = cfs_first(rq)->vruntime;
+	if (min != INT64_MAX && min > rq->min_vruntime)
+		rq->min_vruntime = min;
+}
+
+/* Returns the number of ticks T may run before it is preempted:
+   its weighted share of CFS_LATENCY among the threads in RQ, but
+   at least CFS_MIN_GRANULARITY.  Interrupts must be off. */
+static unsigned
+cfs_slice(struct runqueue *rq, struct thread *t)
+{
+	long load = rq->cfs_load + cfs_weight(t);
+	unsigned slice = (unsigned)((long)CFS_LATENCY * cfs_weight(t) / load);
+	return slice > CFS_MIN_GRANULARITY ? slice : CFS_MIN_GRANULARITY;
+}
+
+/* Charges the running thread T for the current tick, and asks for
+   a reschedule once T has used its slice and is no longer the
+   thread furthest behind.  Called in the timer interrupt. */
+static void
+cfs_tick(struct thread *t)
+{
+	struct runqueue *rq = &ready_rq;
+
+	t->vruntime += (int64_t)CFS_VRUNTIME_TICK * NICE_0_WEIGHT / cfs_weight(t);
+	cfs_update_min_vruntime(rq);
+	if (rq->cnt != 0 && thread_ticks >= cfs_slice(rq, t)
+		&& cfs_first(rq)->vruntime < t->vruntime)
+		intr_yield_on_return();
+}
+
+/* Called when T becomes ready after blocking.  A thread that slept
+   for a long time keeps at most half a latency period of credit
+   over the threads that kept running, so it gets to run soon
+   without starving them.  Interrupts must be off. */
+static void
+cfs_place(struct runqueue *rq, struct thread *t)
+{
+	int64_t floor = rq->min_vruntime - (int64_t)CFS_VRUNTIME_TICK * CFS_LATENCY / 2;
+	if (t->vruntime < floor)
+		t->vruntime = floor;
+}
+
+/* Yields the CPU if a ready thread is far enough behind the
+   running thread in vruntime. */
+static void
+cfs_preemption(void)
+{
+	struct runqueue *rq = &ready_rq;
+	struct thread *cur = thread_current();
+	enum intr_level old_level;
+	bool yield;
+
+	old_level = intr_disable();
+	yield = cur == idle_thread
+		|| (rq->cnt != 0
+			&& cfs_first(rq)->vruntime + (int64_t)CFS_VRUNTIME_TICK * CFS_WAKEUP_GRANULARITY < cur->vruntime);
+	intr_set_level(old_level);
+
+	if (yield)
+		thread_yield();
+}
+
+/* Makes the running thread a deadline thread that needs RUNTIME
+   ticks of CPU time in every PERIOD ticks, each time within
+   DEADLINE ticks of the start of the period, or, if RUNTIME is 0,
+   returns it to its normal scheduling class.  Returns false,
+   changing nothing, if the parameters are not 0 < RUNTIME <=
+   DEADLINE <= PERIOD or if admitting the thread would reserve
+   more than DL_BW_LIMIT of the CPU. */
+bool thread_set_deadline(int64_t runtime, int64_t deadline, int64_t period)
+{
+	struct thread *cur = thread_current();
+	enum intr_level old_level;
+	int64_t bw = 0;
+
+	if (runtime != 0)
+	{
+		if (runtime < 0 || runtime > deadline || deadline > period)
+			return false;
+		bw = (runtime << DL_BW_SHIFT) / period;
+	}
+
+	old_level = intr_disable();
+	if (dl_total_bw - dl_bw(cur) + bw > DL_BW_LIMIT)
+	{
+		intr_set_level(old_level);
+		return false;
+	}
+	dl_total_bw += bw - dl_bw(cur);
+
+	/* The running thread is on no run queue, so it may change class
+	   freely. */
+	timeout_cancel(&cur->dl_timer);
+	cur->dl_runtime = runtime;
+	cur->dl_deadline = deadline;
+	cur->dl_period = period;
+	cur->dl_budget = runtime;
+	cur->dl_abs_deadline = timer_ticks() + deadline;
+	cur->dl_throttled = false;
+	intr_set_level(old_level);
+
+	if (!intr_context())
+		thread_preemption();
+	return true;
+}
+
+/* Orders ready deadline threads by absolute deadline. */
+static bool
+dl_less(const struct rb_elem *a_, const struct rb_elem *b_, void *aux UNUSED)
+{
+	const struct thread *a = rb_entry(a_, struct thread, dl_elem);
+	const struct thread *b = rb_entry(b_, struct thread, dl_elem);
+	return a->dl_abs_deadline < b->dl_abs_deadline;
+}
+
+/* Returns true if a ready deadline thread in RQ should preempt
+   CUR: CUR is not a deadline thread with budget left, or its
+   deadline is later.  Interrupts must be off. */
+static bool
+dl_preempts(struct runqueue *rq, struct thread *cur)
+{
+	struct thread *top;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (rb_empty(&rq->dl_tree))
+		return false;
+	if (!thread_is_dl(cur) || cur->dl_throttled)
+		return true;
+	top = rb_entry(rb_min(&rq->dl_tree), struct thread, dl_elem);
+	return top->dl_abs_deadline < cur->dl_abs_deadline;
+}
+
+/* Returns true if T, just made ready by an interrupt handler,
+   should preempt the running thread CUR when the handler returns.
+   Under CFS, wakeups preempt only at the next tick.  Interrupts
+   must be off. */
+static bool
+wakeup_preempts(struct runqueue *rq, struct thread *cur, struct thread *t)
+{
+	if (dl_preempts(rq, cur))
+		return true;
+	if (cur == idle_thread || thread_is_dl(cur) || thread_is_dl(t) || thread_cfs)
+		return false;
+	return t->priority > cur->priority;
+}
+
+/* Charges the running deadline thread T for the current tick.
+   Once its budget is gone, throttles it until its next period
+   begins.  Called in the timer interrupt. */
+static void
+dl_tick(struct thread *t)
+{
+	int64_t next;
+
+	if (--t->dl_budget > 0)
+		return;
+
+	next = t->dl_abs_deadline - t->dl_deadline + t->dl_period;
+	if (next <= timer_ticks())
+		next = timer_ticks() + 1;
+	t->dl_throttled = true;
+	timeout_add(&t->dl_timer, next);
+	intr_yield_on_return();
+}
+
+/* Called when deadline thread T becomes ready after blocking.
+   T keeps its deadline only if its remaining budget fits before
+   that deadline at its reserved bandwidth; otherwise it starts a
+   fresh period now.  This is the constant bandwidth server rule,
+   which stops a thread that blocks and wakes from claiming more
+   than its reservation.  Interrupts must be off. */
+static void
+dl_wakeup(struct thread *t)
+{
+	int64_t now = timer_ticks();
+
+	if (t->dl_abs_deadline <= now
+		|| t->dl_budget * t->dl_period > (t->dl_abs_deadline - now) * t->dl_runtime)
+	{
+		t->dl_abs_deadline = now + t->dl_deadline;
+		t->dl_budget = t->dl_runtime;
+	}
+}
+
+/* Timeout callback that starts a throttled deadline thread T_'s
+   next period with a full budget, and makes it runnable again. */
+static void
+dl_replenish(void *t_)
+{
+	struct thread *t = t_;
+	struct runqueue *rq = &ready_rq;
+
+	t->dl_budget = t->dl_runtime;
+	t->dl_abs_deadline = timer_ticks() + t->dl_deadline;
+	t->dl_throttled = false;
+	if (t->status == THREAD_READY)
+		rb_insert(&rq->dl_tree, &t->dl_elem, dl_less, NULL);
+	if (dl_preempts(rq, running_thread()))
+		intr_yield_on_return();
+}
+
+/* Stores T's scheduling statistics into *USAGE. */
+void thread_get_rusage(struct thread *t, struct rusage *usage)
+{
+	enum intr_level old_level = intr_disable();
+	usage->utime = t->rusage.utime;
+	usage->stime = t->rusage.stime;
+	usage->wait_time = t->rusage.wait_time;
+	usage->nvcsw = t->rusage.nvcsw;
+	usage->nivcsw = t->rusage.nivcsw;
+	for (int i = 0; i < RUSAGE_WAIT_BUCKETS; i++)
+		usage->wait_hist[i] = t->rusage.wait_hist[i];
+	intr_set_level(old_level);
+}
+
+/* Charges a switch from PREV, whose new status is already set, to
+   NEXT: PREV's switch counts, and the time NEXT spent waiting in
+   the ready queue.  Interrupts must be off. */
+static void
+rusage_switch(struct thread *prev, struct thread *next)
+{
+	int64_t now = timer_ticks();
+	int64_t wait;
+	int bucket;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (prev->status == THREAD_READY)
+	{
+		prev->rusage.nivcsw++;
+		prev->ready_since = now;
+	}
+	else if (prev->status == THREAD_BLOCKED)
+		prev->rusage.nvcsw++;
+
+	if (next == idle_thread)
+		return;
+	wait = now - next->ready_since;
+	for (bucket = 0; bucket < RUSAGE_WAIT_BUCKETS - 1 && wait >> bucket != 0; bucket++)
+		continue;
+	next->rusage.wait_time += wait;
+	next->rusage.wait_hist[bucket]++;
+}
@@ -0,0 +1,80 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/hrtimer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* Number of events the ring buffer holds.  A power of 2. */
+#define TRACE_CNT 4096
+
+/* One recorded event. */
+struct trace_entry {
+	uint64_t tsc;               /* Time-stamp counter. */
+	int64_t arg;                /* Depends on TYPE. */
+	int32_t tid;                /* Thread the event is about. */
+	uint8_t type;               /* An enum trace_type. */
+	uint8_t priority;           /* Thread's priority. */
+};
+
+/* -trace: Record scheduler events? */
+bool trace_enabled;
+
+/* Ring buffer.  Event number N is in trace_buf[N % TRACE_CNT]. */
+static struct trace_entry trace_buf[TRACE_CNT];
+static uint64_t trace_cnt;      /* Events recorded so far. */
+
+static const char *type_names[] = {
+	[TRACE_SWITCH] = "switch",
+	[TRACE_BLOCK] = "block",
+	[TRACE_UNBLOCK] = "unblock",
+	[TRACE_SLEEP] = "sleep",
+	[TRACE_WAKE] = "wake",
+	[TRACE_DONATE] = "donate",
+	[TRACE_CONTEND] = "contend",
+};
+
+/* Records an event of type TYPE about thread T with argument ARG.
+   Use trace_record() instead, which costs only a test of
+   trace_enabled when tracing is off.  May be called from an
+   interrupt handler. */
+void
+trace_event (enum trace_type type, const struct thread *t, int64_t arg) {
+	enum intr_level old_level = intr_disable ();
+	struct trace_entry *e = &trace_buf[trace_cnt++ % TRACE_CNT];
+
+	e->tsc = rdtsc ();
+	e->arg = arg;
+	e->tid = t->tid;
+	e->type = type;
+	e->priority = t->priority;
+	intr_set_level (old_level);
+}
+
+/* Prints the recorded events, oldest first, preceded by a header
+   giving the time-stamp counter's rate. */
+void
+trace_dump (void) {
+	enum intr_level old_level;
+	uint64_t first, last;
+
+	/* Stop recording while we print, or printing's own wakeups
+	   would overwrite the events being printed. */
+	old_level = intr_disable ();
+	bool enabled = trace_enabled;
+	trace_enabled = false;
+	last = trace_cnt;
+	first = last > TRACE_CNT ? last - TRACE_CNT : 0;
+	intr_set_level (old_level);
+
+	printf ("Scheduler trace: %llu events, %llu kept, TSC %llu Hz\n",
+			last, last - first, hrtimer_tsc_hz ());
+	for (uint64_t i = first; i < last; i++) {
+		const struct trace_entry *e = &trace_buf[i % TRACE_CNT];
+		printf ("trace: %llu %s %d %d %lld\n",
+				e->tsc, type_names[e->type], e->tid, e->priority, e->arg);
+	}
+
+	trace_enabled = enabled;
+}
@@ -0,0 +1,306 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A worker thread. */
+struct worker {
+	struct workqueue *wq;       /* Queue it serves. */
+	struct work *current;       /* Item it is running, or null. */
+};
+
+/* A work queue. */
+struct workqueue {
+	const char *name;           /* Name, for worker threads. */
+	struct rb_tree pending;     /* Queued items, highest priority first. */
+	struct wait_queue idle;     /* Workers waiting for work. */
+	struct wait_queue done;     /* Threads in flush_*(). */
+	int running;                /* Items being run. */
+	int worker_cnt;             /* Number of workers. */
+	struct worker *workers;     /* Array of WORKER_CNT workers. */
+};
+
+struct workqueue *system_wq;
+struct workqueue *system_highpri_wq;
+
+static thread_func worker_main;
+static timeout_func delayed_work_timer;
+static bool work_less (const struct rb_elem *, const struct rb_elem *,
+                       void *aux);
+static bool work_running (struct work *);
+
+/* Creates the shared work queues.  Must be called from
+   thread_start(), once the idle thread is running. */
+void
+workqueue_init (void) {
+	system_wq = workqueue_create ("kworker", 2, PRI_DEFAULT);
+	system_highpri_wq = workqueue_create ("kworker-hi", 1, PRI_MAX);
+	if (system_wq == NULL || system_highpri_wq == NULL)
+		PANIC ("cannot create the system work queues");
+}
+
+/* Creates a work queue named NAME served by WORKERS kernel threads
+   running at PRIORITY.  Returns the new queue, or a null pointer
+   if memory or its first worker thread cannot be had; if only
+   some of the workers can be created, the queue is served by
+   those.  Work queues are never destroyed.
+
+   Worker threads do not take part in the MLFQS accounting: they
+   keep PRIORITY whatever scheduler is in use. */
+struct workqueue *
+workqueue_create (const char *name, int workers, int priority) {
+	struct workqueue *wq;
+	int i;
+
+	ASSERT (name != NULL);
+	ASSERT (workers > 0);
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+	wq = malloc (sizeof *wq);
+	if (wq == NULL)
+		return NULL;
+	wq->workers = calloc (workers, sizeof *wq->workers);
+	if (wq->workers == NULL) {
+		free (wq);
+		return NULL;
+	}
+	wq->name = name;
+	rb_init (&wq->pending);
+	wait_queue_init (&wq->idle);
+	wait_queue_init (&wq->done);
+	wq->running = 0;
+
+	for (i = 0; i < workers; i++) {
+		wq->workers[i].wq = wq;
+		wq->workers[i].current = NULL;
+		if (thread_create (name, priority, worker_main,
+		                   &wq->workers[i]) == TID_ERROR)
+			break;
+	}
+	if (i == 0) {
+		free (wq->workers);
+		free (wq);
+		return NULL;
+	}
+	wq->worker_cnt = i;
+	return wq;
+}
+
+/* Initializes W to run FUNC at PRIORITY, higher values running
+   first. */
+void
+work_init (struct work *w, work_func *func, int priority) {
+	ASSERT (w != NULL);
+	ASSERT (func != NULL);
+
+	w->func = func;
+	w->priority = priority;
+	w->wq = NULL;
+	w->pending = false;
+}
+
+/* Initializes DW to run FUNC at PRIORITY once its delay expires. */
+void
+delayed_work_init (struct delayed_work *dw, work_func *func, int priority) {
+	ASSERT (dw != NULL);
+
+	work_init (&dw->work, func, priority);
+	timeout_init (&dw->timer, delayed_work_timer, dw);
+}
+
+/* Queues W on WQ.  Returns true if W was queued, false if it was
+   already pending.
+
+   May be called from an interrupt handler, in which case a woken
+   worker that should preempt the running thread runs as soon as
+   the handler returns, as thread_unblock() decides. */
+bool
+queue_work (struct workqueue *wq, struct work *w) {
+	enum intr_level old_level;
+
+	ASSERT (wq != NULL);
+	ASSERT (w != NULL);
+
+	old_level = intr_disable ();
+	if (w->pending) {
+		intr_set_level (old_level);
+		return false;
+	}
+	w->pending = true;
+	w->wq = wq;
+	rb_insert (&wq->pending, &w->elem, work_less, NULL);
+	wait_queue_wake (&wq->idle, 1);
+	intr_set_level (old_level);
+
+	thread_preemption ();
+	return true;
+}
+
+/* Queues DW on WQ after DELAY timer ticks, or at once if DELAY is
+   not positive.  Returns true if DW was queued or armed, false if
+   it was already. */
+bool
+queue_delayed_work (struct workqueue *wq, struct delayed_work *dw,
+                    int64_t delay) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (wq != NULL);
+	ASSERT (dw != NULL);
+
+	if (delay <= 0)
+		return queue_work (wq, &dw->work);
+
+	old_level = intr_disable ();
+	if (!dw->work.pending && !timeout_pending (&dw->timer)) {
+		dw->work.wq = wq;
+		timeout_add (&dw->timer, timer_ticks () + delay);
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Removes W from its queue if it is pending.  Returns true if it
+   was.  Does not wait for a run of W that has already started;
+   follow with flush_work() for that. */
+bool
+cancel_work (struct work *w) {
+	enum intr_level old_level;
+	bool pending;
+
+	ASSERT (w != NULL);
+
+	old_level = intr_disable ();
+	pending = w->pending;
+	if (pending) {
+		rb_remove (&w->wq->pending, &w->elem);
+		w->pending = false;
+	}
+	intr_set_level (old_level);
+	return pending;
+}
+
+/* Disarms DW's timer and removes it from its queue.  Returns true
+   if DW was armed or pending. */
+bool
+cancel_delayed_work (struct delayed_work *dw) {
+	bool armed;
+
+	ASSERT (dw != NULL);
+
+	armed = timeout_cancel (&dw->timer);
+	return cancel_work (&dw->work) || armed;
+}
+
+/* Waits until W is neither pending nor running.  W must not be
+   requeued meanwhile for this to terminate, and must not be
+   flushed from a worker of its own queue. */
+void
+flush_work (struct work *w) {
+	enum intr_level old_level;
+
+	ASSERT (w != NULL);
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	while (w->wq != NULL && (w->pending || work_running (w)))
+		wait_queue_sleep (&w->wq->done, false);
+	intr_set_level (old_level);
+}
+
+/* Queues DW at once if its timer is armed, then waits for it as
+   flush_work() does. */
+void
+flush_delayed_work (struct delayed_work *dw) {
+	ASSERT (dw != NULL);
+
+	if (timeout_cancel (&dw->timer))
+		queue_work (dw->work.wq, &dw->work);
+	flush_work (&dw->work);
+}
+
+/* Waits until WQ has nothing pending or running.  Must not be
+   called from one of WQ's own workers. */
+void
+flush_workqueue (struct workqueue *wq) {
+	enum intr_level old_level;
+
+	ASSERT (wq != NULL);
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	while (!rb_empty (&wq->pending) || wq->running > 0)
+		wait_queue_sleep (&wq->done, false);
+	intr_set_level (old_level);
+}
+
+/* A worker thread.  Runs WORKER_'s queue's items one at a time,
+   sleeping while there are none. */
+static void
+worker_main (void *worker_) {
+	struct worker *worker = worker_;
+	struct workqueue *wq = worker->wq;
+
+	thread_current ()->kworker = true;
+	intr_disable ();
+	for (;;) {
+		struct work *w;
+
+		while (rb_empty (&wq->pending))
+			wait_queue_sleep (&wq->idle, true);
+
+		w = rb_entry (rb_min (&wq->pending), struct work, elem);
+		rb_remove (&wq->pending, &w->elem);
+		w->pending = false;
+		worker->current = w;
+		wq->running++;
+		intr_enable ();
+
+		/* W may be freed or requeued by its function: only its
+		   address is used below. */
+		w->func (w);
+
+		intr_disable ();
+		worker->current = NULL;
+		wq->running--;
+		if (wait_queue_wake (&wq->done, 0) > 0) {
+			intr_enable ();
+			thread_preemption ();
+			intr_disable ();
+		}
+	}
+}
+
+/* Timer callback for delayed work DW_. */
+static void
+delayed_work_timer (void *dw_) {
+	struct delayed_work *dw = dw_;
+
+	queue_work (dw->work.wq, &dw->work);
+}
+
+/* Orders work items by descending priority. */
+static bool
+work_less (const struct rb_elem *a_, const struct rb_elem *b_,
+           void *aux UNUSED) {
+	const struct work *a = rb_entry (a_, struct work, elem);
+	const struct work *b = rb_entry (b_, struct work, elem);
+
+	return a->priority > b->priority;
+}
+
+/* Returns true if one of W's queue's workers is running W.
+   Interrupts must be off. */
+static bool
+work_running (struct work *w) {
+	struct workqueue *wq = w->wq;
+	int i;
+
+	for (i = 0; i < wq->worker_cnt; i++)
+		if (wq->workers[i].current == w)
+			return true;
+	return false;
+}
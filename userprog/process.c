@@ -120,7 +120,7 @@ duplicate_pte(uint64_t *pte, void *va, void *aux)
 	/* 4. TODO: Duplicate parent's page to the new page and
 	 *    TODO: check whether parent's page is writable or not (set WRITABLE
 	 *    TODO: according to the result). */
-	memcpy(newpage, parent_page, PGSIZE);
+	copy_page(newpage, parent_page);
 	writable = is_writable(pte);
 
 	/* 5. Add new page to child's page table at address VA with WRITABLE
@@ -170,21 +170,25 @@ __do_fork(void *aux)
 	 * TODO:       in include/filesys/file.h. Note that parent should not return
 	 * TODO:       from the fork() until this function successfully duplicates
 	 * TODO:       the resources of parent.*/
-	int fd = 2;
-	// struct file **table = parent->fdt;
-	while (fd < 128)
+	if (parent->fdt != NULL)
 	{
-		if (parent->fdt[fd])
+		if (process_fdt(true) == NULL)
+			goto error;
+		int fd = 2;
+		while (fd < FDT_MAX)
 		{
-			current->fdt[fd] = file_duplicate(parent->fdt[fd]);
-		}
-		else
-		{
-			current->fdt[fd] = NULL;
+			if (parent->fdt[fd])
+			{
+				current->fdt[fd] = file_duplicate(parent->fdt[fd]);
+			}
+			else
+			{
+				current->fdt[fd] = NULL;
+			}
+			fd++;
 		}
-		fd++;
+		current->next_fd = parent->next_fd;
 	}
-	current->next_fd = parent->next_fd;
 
 	sema_up(&parent->sema_fork);
 
@@ -267,7 +271,7 @@ void process_exit(void)
 		file_close(cur_thread->running_file);
 
 	int fd = 2;
-	while (fd < 128)
+	while (cur_thread->fdt != NULL && fd < FDT_MAX)
 	{
 		if (cur_thread->fdt[fd] != NULL)
 		{
@@ -281,9 +285,33 @@ void process_exit(void)
 	sema_down(&cur_thread->sema_exit);
 
 	palloc_free_page(cur_thread->fdt);
+	cur_thread->fdt = NULL;
 	process_cleanup();
 }
 
+/* Returns the current thread's file descriptor table.  The table
+ * is allocated on first use, so kernel threads and processes that
+ * never open a file do not pay for a zeroed page.  Returns a null
+ * pointer if there is no table yet and CREATE is false, or if the
+ * allocation fails. */
+struct file **
+process_fdt(bool create)
+{
+	struct thread *cur = thread_current();
+
+	if (cur->fdt == NULL && create)
+	{
+		cur->fdt = palloc_get_page(PAL_ZERO);
+		if (cur->fdt != NULL)
+		{
+			cur->fdt[0] = (struct file *)1;
+			cur->fdt[1] = (struct file *)2;
+			cur->next_fd = 2;
+		}
+	}
+	return cur->fdt;
+}
+
 /* Free the current process's resources. */
 static void
 process_cleanup(void)
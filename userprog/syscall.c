@@ -12,9 +12,15 @@
 #include "threads/palloc.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "userprog/process.h"
+#include "threads/trace.h"
+#include "devices/hrtimer.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
+static struct file *fd_to_file (int fd);
+
+struct rwlock filesys_lock;
 
 /* System call.
  *
@@ -31,7 +37,7 @@ void syscall_handler (struct intr_frame *);
 
 void syscall_init (void) 
 {
-  	lock_init(&filesys_lock);
+  	rw_init(&filesys_lock);
 
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
@@ -93,6 +99,18 @@ void syscall_handler (struct intr_frame *f UNUSED)
 		case SYS_CLOSE:
 			close(f->R.rdi);
 			break;
+		case SYS_TRACE_DUMP:
+			trace_dump();
+			break;
+		case SYS_GETRUSAGE:
+			f->R.rax = getrusage(f->R.rdi, (struct rusage *) f->R.rsi);
+			break;
+		case SYS_SCHED_DEADLINE:
+			f->R.rax = sched_deadline(f->R.rdi, f->R.rsi, f->R.rdx);
+			break;
+		case SYS_CLOCK_GETTIME:
+			f->R.rax = clock_gettime(f->R.rdi, (struct timespec *) f->R.rsi);
+			break;
 		default:
 			exit(-1);
 			break;
@@ -166,11 +184,12 @@ int open (const char *file)
 	struct file *fd = filesys_open(file);
 	if (fd) 
 	{
-		for (int i = 2; i < 128; i++) 
+		struct file **fdt = process_fdt(true);
+		for (int i = 2; fdt != NULL && i < FDT_MAX; i++) 
 		{
-			if (!cur->fdt[i]) 
+			if (!fdt[i]) 
 			{
-				cur->fdt[i] = fd;
+				fdt[i] = fd;
 				cur->next_fd = i + 1;
 				return i;
 			}
@@ -180,9 +199,20 @@ int open (const char *file)
 	return -1;
 }
 
+/* Returns the file open as FD in the current process, or a null
+   pointer if FD is not an open file. */
+static struct file *
+fd_to_file (int fd)
+{
+	struct file **fdt = process_fdt(false);
+	if (fdt == NULL || fd < 2 || fd >= FDT_MAX)
+		return NULL;
+	return fdt[fd];
+}
+
 int filesize (int fd) 
 {
-	struct file *file = thread_current()->fdt[fd];
+	struct file *file = fd_to_file(fd);
 	if (file)
 		return file_length(file);
 	return -1;
@@ -196,17 +226,17 @@ int read (int fd, void *buffer, unsigned size)
 
 	if (fd == 0) 
 	{
-		lock_acquire(&filesys_lock);
+		rw_write_acquire(&filesys_lock);
 		int byte = input_getc();
-		lock_release(&filesys_lock);
+		rw_write_release(&filesys_lock);
 		return byte;
 	}
-	struct file *file = thread_current()->fdt[fd];
+	struct file *file = fd_to_file(fd);
 	if (file) 
 	{
-		lock_acquire(&filesys_lock);
+		rw_read_acquire(&filesys_lock);
 		int read_byte = file_read(file, buffer, size);
-		lock_release(&filesys_lock);
+		rw_read_release(&filesys_lock);
 		return read_byte;
 	}
 	return -1;
@@ -221,43 +251,89 @@ int write (int fd UNUSED, const void *buffer, unsigned size)
 
 	if (fd == 1) 
 	{
-		lock_acquire(&filesys_lock);
+		rw_write_acquire(&filesys_lock);
 		putbuf(buffer, size);
-		lock_release(&filesys_lock);
+		rw_write_release(&filesys_lock);
 		return size;
 	}
 
-	struct file *file = thread_current()->fdt[fd];
+	struct file *file = fd_to_file(fd);
 	if (file) 
 	{
-		lock_acquire(&filesys_lock);
+		rw_write_acquire(&filesys_lock);
 		int write_byte = file_write(file, buffer, size);
-		lock_release(&filesys_lock);
+		rw_write_release(&filesys_lock);
 		return write_byte;
 	}
 }
 
 void seek (int fd, unsigned position) 
 {
-	struct file *curfile = thread_current()->fdt[fd];
+	struct file *curfile = fd_to_file(fd);
 	if (curfile)
 		file_seek(curfile, position);
 }
 
 unsigned tell (int fd) 
 {
-	struct file *curfile = thread_current()->fdt[fd];
+	struct file *curfile = fd_to_file(fd);
 	if (curfile)
 		return file_tell(curfile);
 }
 
 void close (int fd) 
 {
-	struct file * file = thread_current()->fdt[fd];
+	struct file * file = fd_to_file(fd);
 	if (file) {
-		lock_acquire(&filesys_lock);
-		thread_current()->fdt[fd] = NULL;
+		rw_write_acquire(&filesys_lock);
+		process_fdt(false)[fd] = NULL;
 		file_close(file);
-		lock_release(&filesys_lock);
+		rw_write_release(&filesys_lock);
 	}
-}
\ No newline at end of file
+}
+
+/* Stores the scheduling statistics of process PID, which must be
+   the caller (or 0 for the caller) or one of its children, into
+   USAGE.  Returns 0 if successful, -1 if there is no such
+   process. */
+int getrusage (int pid, struct rusage *usage)
+{
+	check_address(usage);
+	check_address((uint8_t *) usage + sizeof *usage - 1);
+
+	struct thread *t = thread_current();
+	if (pid != 0 && pid != t->tid)
+		t = get_child_process(pid);
+	if (t == NULL)
+		return -1;
+
+	thread_get_rusage(t, usage);
+	return 0;
+}
+
+/* Makes the calling process a deadline process that needs RUNTIME
+   ticks of CPU time within DEADLINE ticks of the start of each
+   PERIOD ticks, or returns it to normal scheduling if RUNTIME is
+   0.  Returns 0 if successful, -1 if the parameters are invalid or
+   the CPU time cannot be reserved. */
+int sched_deadline (int runtime, int deadline, int period)
+{
+	return thread_set_deadline(runtime, deadline, period) ? 0 : -1;
+}
+
+/* Stores the current time of clock CLOCK into TS.  Only
+   CLOCK_MONOTONIC, the nanoseconds since boot, is supported.
+   Returns 0 if successful, -1 if CLOCK is unknown. */
+int clock_gettime (int clock, struct timespec *ts)
+{
+	check_address(ts);
+	check_address((uint8_t *) ts + sizeof *ts - 1);
+
+	if (clock != CLOCK_MONOTONIC)
+		return -1;
+
+	uint64_t now = hrtimer_now();
+	ts->tv_sec = now / NSEC_PER_SEC;
+	ts->tv_nsec = now % NSEC_PER_SEC;
+	return 0;
+}